@@ -29,7 +29,11 @@
 #include <vdr/videodir.h>
 
 #include "config.h"
+#include "live/demuxerpool.h"
 #include "live/livequeue.h"
+#include "live/livesessions.h"
+#include "live/livestandby.h"
+#include "robotv/clientmultiplexer.h"
 
 RoboTVServerConfig::RoboTVServerConfig() : listenPort(LISTEN_PORT) {
 }
@@ -57,6 +61,27 @@ bool RoboTVServerConfig::Parse(const char* Name, const char* Value) {
     else if(!strcasecmp(Name, "MaxTimeShiftSize")) {
         LiveQueue::setBufferSize(strtoull(Value, NULL, 10));
     }
+    else if(!strcasecmp(Name, "TimeShiftStorage")) {
+        LiveQueue::setStorageType(strcasecmp(Value, "mmap") == 0 ? TimeShiftStorage::Type::MMAP : TimeShiftStorage::Type::FILE);
+    }
+    else if(!strcasecmp(Name, "TimeShiftMemorySize")) {
+        LiveQueue::setMemorySize(strtoull(Value, NULL, 10));
+    }
+    else if(!strcasecmp(Name, "TimeShiftSessionTimeout")) {
+        LiveSessions::setTimeout(atoi(Value));
+    }
+    else if(!strcasecmp(Name, "StandbyReceivers")) {
+        LiveStandby::setCount(atoi(Value));
+    }
+    else if(!strcasecmp(Name, "DemuxerThreads")) {
+        DemuxerPool::setThreads(atoi(Value));
+    }
+    else if(!strcasecmp(Name, "NetworkThreads")) {
+        ClientMultiplexer::setThreads(atoi(Value));
+    }
+    else if(!strcasecmp(Name, "RequestThreads")) {
+        ClientMultiplexer::setWorkers(atoi(Value));
+    }
     else if(!strcasecmp(Name, "PiconsURL")) {
         piconsUrl = Value;
     }
@@ -0,0 +1,642 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/**
+ * robotvdmx benchmark
+ *
+ * replays captured transport streams through the demuxer and reports
+ * throughput (MB/s, packets/s), ns/frame and heap allocations per frame
+ * for every parser type. Results can be written to and compared against
+ * a baseline file ("<key> <value>" per line).
+ *
+ * usage: robotvdmx-benchmark [-i iterations] [-w baseline] [-b baseline] [-t tolerance] file.ts ...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "robotvdmx/demuxer.h"
+#include "robotvdmx/demuxerbundle.h"
+#include "robotvdmx/pes.h"
+#include "robotvdmx/streambundle.h"
+
+// heap allocation counter
+
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+
+    if(p == NULL) {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+// frame counting listener
+
+class CountingListener : public TsDemuxer::Listener {
+public:
+
+    void onStreamPacket(TsDemuxer::StreamPacket* p) {
+        frames[p->pid]++;
+        bytes[p->pid] += p->size;
+    }
+
+    void onStreamChange() {
+        changes++;
+    }
+
+    // register a pid before measuring (keeps map inserts out of the allocation count)
+    void add(int pid) {
+        frames[pid] = 0;
+        bytes[pid] = 0;
+    }
+
+    std::map<int, uint64_t> frames;
+
+    std::map<int, uint64_t> bytes;
+
+    uint64_t changes = 0;
+
+};
+
+// accumulated results of a parser type
+
+struct Result {
+    uint64_t bytes = 0;
+    uint64_t packets = 0;
+    uint64_t frames = 0;
+    uint64_t allocations = 0;
+    double seconds = 0;
+};
+
+typedef std::map<std::string, double> Metrics;
+
+// transport stream capture
+
+class Capture {
+public:
+
+    bool load(const char* filename);
+
+    StreamBundle streams() const;
+
+    const std::vector<uint8_t>& data() const {
+        return m_data;
+    }
+
+    int packetCount() const {
+        return (int)(m_data.size() / TS_SIZE);
+    }
+
+private:
+
+    void parsePat(const uint8_t* section, int length);
+
+    void parsePmt(const uint8_t* section, int length);
+
+    void addStream(int pid, int streamType, const uint8_t* descriptors, int length);
+
+    std::vector<uint8_t> m_data;
+
+    std::map<int, std::vector<uint8_t>> m_sections;
+
+    std::map<int, bool> m_pmtPids;
+
+    StreamBundle m_streams;
+
+};
+
+bool Capture::load(const char* filename) {
+    std::ifstream file(filename, std::ios::binary);
+
+    if(!file) {
+        return false;
+    }
+
+    std::vector<uint8_t> raw((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // copy aligned packets only
+    for(size_t i = 0; i + TS_SIZE <= raw.size();) {
+        if(raw[i] != TS_SYNC_BYTE) {
+            i++;
+            continue;
+        }
+
+        m_data.insert(m_data.end(), raw.begin() + i, raw.begin() + i + TS_SIZE);
+        i += TS_SIZE;
+    }
+
+    // collect PAT / PMT sections
+    for(size_t i = 0; i < m_data.size(); i += TS_SIZE) {
+        const uint8_t* p = &m_data[i];
+        int pid = TsPid(p);
+
+        if(pid != 0 && m_pmtPids.find(pid) == m_pmtPids.end()) {
+            continue;
+        }
+
+        if(!TsHasPayload(p) || TsError(p)) {
+            continue;
+        }
+
+        int offset = TsPayloadOffset(p);
+
+        if(offset >= TS_SIZE) {
+            continue;
+        }
+
+        std::vector<uint8_t>& section = m_sections[pid];
+
+        if(TsPayloadStart(p)) {
+            offset += 1 + p[offset]; // pointer field
+            section.clear();
+        }
+        else if(section.empty()) {
+            continue;
+        }
+
+        if(offset >= TS_SIZE) {
+            continue;
+        }
+
+        section.insert(section.end(), p + offset, p + TS_SIZE);
+
+        if(section.size() < 3) {
+            continue;
+        }
+
+        int length = 3 + (((section[1] & 0x0F) << 8) | section[2]);
+
+        if((int)section.size() < length) {
+            continue;
+        }
+
+        if(pid == 0) {
+            parsePat(section.data(), length);
+        }
+        else {
+            parsePmt(section.data(), length);
+        }
+
+        section.clear();
+    }
+
+    return !m_data.empty();
+}
+
+void Capture::parsePat(const uint8_t* section, int length) {
+    // skip header, stop before CRC
+    for(int i = 8; i + 4 <= length - 4; i += 4) {
+        int program = (section[i] << 8) | section[i + 1];
+        int pid = ((section[i + 2] & 0x1F) << 8) | section[i + 3];
+
+        if(program != 0) {
+            m_pmtPids[pid] = true;
+        }
+    }
+}
+
+void Capture::parsePmt(const uint8_t* section, int length) {
+    if(length < 16) {
+        return;
+    }
+
+    int infoLength = ((section[10] & 0x0F) << 8) | section[11];
+
+    for(int i = 12 + infoLength; i + 5 <= length - 4;) {
+        int streamType = section[i];
+        int pid = ((section[i + 1] & 0x1F) << 8) | section[i + 2];
+        int esInfoLength = ((section[i + 3] & 0x0F) << 8) | section[i + 4];
+
+        addStream(pid, streamType, section + i + 5, std::min(esInfoLength, length - 4 - (i + 5)));
+        i += 5 + esInfoLength;
+    }
+}
+
+void Capture::addStream(int pid, int streamType, const uint8_t* descriptors, int length) {
+    StreamInfo::Type type = StreamInfo::Type::NONE;
+
+    switch(streamType) {
+        case 0x01:
+        case 0x02:
+            type = StreamInfo::Type::MPEG2VIDEO;
+            break;
+
+        case 0x03:
+        case 0x04:
+            type = StreamInfo::Type::MPEG2AUDIO;
+            break;
+
+        case 0x0F:
+            type = StreamInfo::Type::AAC;
+            break;
+
+        case 0x11:
+            type = StreamInfo::Type::LATM;
+            break;
+
+        case 0x1B:
+            type = StreamInfo::Type::H264;
+            break;
+
+        case 0x24:
+            type = StreamInfo::Type::H265;
+            break;
+
+        case 0x81:
+            type = StreamInfo::Type::AC3;
+            break;
+
+        case 0x87:
+            type = StreamInfo::Type::EAC3;
+            break;
+
+        case 0x06:
+            // private data, check descriptors
+            for(int i = 0; i + 2 <= length; i += 2 + descriptors[i + 1]) {
+                switch(descriptors[i]) {
+                    case 0x6A:
+                        type = StreamInfo::Type::AC3;
+                        break;
+
+                    case 0x7A:
+                        type = StreamInfo::Type::EAC3;
+                        break;
+
+                    case 0x59:
+                        type = StreamInfo::Type::DVBSUB;
+                        break;
+
+                    case 0x56:
+                        type = StreamInfo::Type::TELETEXT;
+                        break;
+                }
+            }
+
+            break;
+    }
+
+    if(type != StreamInfo::Type::NONE) {
+        m_streams.addStream(StreamInfo(pid, type));
+    }
+}
+
+StreamBundle Capture::streams() const {
+    return m_streams;
+}
+
+// benchmark runs
+
+static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void benchmarkStream(const Capture& capture, const StreamInfo& info, int iterations, Result& result) {
+    // extract the packets of this stream
+    std::vector<uint8_t> packets;
+    const std::vector<uint8_t>& data = capture.data();
+
+    for(size_t i = 0; i < data.size(); i += TS_SIZE) {
+        if(TsPid(&data[i]) == info.getPid()) {
+            packets.insert(packets.end(), data.begin() + i, data.begin() + i + TS_SIZE);
+        }
+    }
+
+    if(packets.empty()) {
+        return;
+    }
+
+    double best = 0;
+    uint64_t frames = 0;
+    uint64_t allocs = 0;
+
+    for(int n = 0; n < iterations; n++) {
+        CountingListener listener;
+        TsDemuxer demuxer(&listener, info);
+        listener.add(info.getPid());
+
+        uint64_t a = allocations;
+        double start = now();
+
+        for(size_t i = 0; i < packets.size(); i += TS_SIZE) {
+            demuxer.processTsPacket(&packets[i]);
+        }
+
+        double elapsed = now() - start;
+
+        if(n == 0 || elapsed < best) {
+            best = elapsed;
+        }
+
+        frames = listener.frames[info.getPid()];
+        allocs = allocations - a;
+    }
+
+    result.bytes += packets.size();
+    result.packets += packets.size() / TS_SIZE;
+    result.frames += frames;
+    result.allocations += allocs;
+    result.seconds += best;
+}
+
+static void benchmarkBundle(const Capture& capture, int iterations, Result& result) {
+    std::vector<uint8_t> data = capture.data();
+    StreamBundle streams = capture.streams();
+    double best = 0;
+    uint64_t frames = 0;
+    uint64_t allocs = 0;
+
+    for(int n = 0; n < iterations; n++) {
+        CountingListener listener;
+        DemuxerBundle bundle(&listener);
+        bundle.updateFrom(&streams);
+
+        for(auto& i : streams) {
+            listener.add(i.first);
+        }
+
+        uint64_t a = allocations;
+        double start = now();
+
+        bundle.processTsPackets(data.data(), (int)data.size());
+
+        double elapsed = now() - start;
+
+        if(n == 0 || elapsed < best) {
+            best = elapsed;
+        }
+
+        frames = 0;
+
+        for(auto& i : listener.frames) {
+            frames += i.second;
+        }
+
+        allocs = allocations - a;
+    }
+
+    result.bytes += data.size();
+    result.packets += data.size() / TS_SIZE;
+    result.frames += frames;
+    result.allocations += allocs;
+    result.seconds += best;
+}
+
+static void addMetrics(Metrics& metrics, const std::string& name, const Result& r) {
+    if(r.seconds <= 0 || r.frames == 0) {
+        return;
+    }
+
+    metrics[name + ".mb_per_s"] = (double)r.bytes / r.seconds / 1e6;
+    metrics[name + ".packets_per_s"] = (double)r.packets / r.seconds;
+    metrics[name + ".ns_per_frame"] = r.seconds * 1e9 / (double)r.frames;
+    metrics[name + ".allocs_per_frame"] = (double)r.allocations / (double)r.frames;
+}
+
+// baseline handling
+
+static bool readBaseline(const char* filename, Metrics& metrics) {
+    std::ifstream file(filename);
+
+    if(!file) {
+        return false;
+    }
+
+    std::string key;
+    double value;
+
+    while(file >> key >> value) {
+        metrics[key] = value;
+    }
+
+    return true;
+}
+
+static bool writeBaseline(const char* filename, const Metrics& metrics) {
+    std::ofstream file(filename);
+
+    if(!file) {
+        return false;
+    }
+
+    file.precision(10);
+
+    for(auto& i : metrics) {
+        file << i.first << " " << i.second << std::endl;
+    }
+
+    return true;
+}
+
+// lower is better for these metrics
+static bool lowerIsBetter(const std::string& key) {
+    return key.find(".ns_per_frame") != std::string::npos || key.find(".allocs_per_frame") != std::string::npos;
+}
+
+static int compareBaseline(const Metrics& baseline, const Metrics& metrics, double tolerance) {
+    int regressions = 0;
+
+    for(auto& i : baseline) {
+        auto m = metrics.find(i.first);
+
+        if(m == metrics.end()) {
+            continue;
+        }
+
+        double base = i.second;
+        double value = m->second;
+        bool regression = false;
+
+        if(lowerIsBetter(i.first)) {
+            // allow a small absolute slack for allocation counts near zero
+            double slack = i.first.find(".allocs_per_frame") != std::string::npos ? 0.01 : 0;
+            regression = (value > base * (1.0 + tolerance) + slack);
+        }
+        else {
+            regression = (value < base * (1.0 - tolerance));
+        }
+
+        if(regression) {
+            fprintf(stderr, "REGRESSION %s: %.3f (baseline %.3f)\n", i.first.c_str(), value, base);
+            regressions++;
+        }
+    }
+
+    return regressions;
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [-i iterations] [-w baseline] [-b baseline] [-t tolerance] file.ts ...\n", name);
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = 5;
+    double tolerance = 0.2;
+    const char* writeFile = NULL;
+    const char* baselineFile = NULL;
+    int c;
+
+    while((c = getopt(argc, argv, "i:w:b:t:h")) != -1) {
+        switch(c) {
+            case 'i':
+                iterations = std::max(1, atoi(optarg));
+                break;
+
+            case 'w':
+                writeFile = optarg;
+                break;
+
+            case 'b':
+                baselineFile = optarg;
+                break;
+
+            case 't':
+                tolerance = atof(optarg);
+                break;
+
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if(optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::map<std::string, Result> results;
+    Result total;
+
+    for(int f = optind; f < argc; f++) {
+        Capture capture;
+
+        if(!capture.load(argv[f])) {
+            fprintf(stderr, "unable to load '%s'\n", argv[f]);
+            return 2;
+        }
+
+        StreamBundle streams = capture.streams();
+
+        if(streams.empty()) {
+            fprintf(stderr, "no streams found in '%s'\n", argv[f]);
+            continue;
+        }
+
+        for(auto& i : streams) {
+            benchmarkStream(capture, i.second, iterations, results[StreamInfo::typeName(i.second.getType())]);
+        }
+
+        benchmarkBundle(capture, iterations, total);
+    }
+
+    Metrics metrics;
+
+    for(auto& i : results) {
+        addMetrics(metrics, i.first, i.second);
+    }
+
+    addMetrics(metrics, "TOTAL", total);
+
+    // report
+    printf("%-12s %10s %14s %12s %14s\n", "parser", "MB/s", "packets/s", "ns/frame", "allocs/frame");
+
+    for(auto& i : results) {
+        const std::string& name = i.first;
+
+        if(metrics.find(name + ".mb_per_s") == metrics.end()) {
+            continue;
+        }
+
+        printf("%-12s %10.1f %14.0f %12.1f %14.3f\n", name.c_str(),
+               metrics[name + ".mb_per_s"],
+               metrics[name + ".packets_per_s"],
+               metrics[name + ".ns_per_frame"],
+               metrics[name + ".allocs_per_frame"]);
+    }
+
+    if(metrics.find("TOTAL.mb_per_s") != metrics.end()) {
+        printf("%-12s %10.1f %14.0f %12.1f %14.3f\n", "TOTAL",
+               metrics["TOTAL.mb_per_s"],
+               metrics["TOTAL.packets_per_s"],
+               metrics["TOTAL.ns_per_frame"],
+               metrics["TOTAL.allocs_per_frame"]);
+    }
+
+    if(writeFile != NULL && !writeBaseline(writeFile, metrics)) {
+        fprintf(stderr, "unable to write baseline '%s'\n", writeFile);
+        return 2;
+    }
+
+    if(baselineFile != NULL) {
+        Metrics baseline;
+
+        if(!readBaseline(baselineFile, baseline)) {
+            fprintf(stderr, "unable to read baseline '%s'\n", baselineFile);
+            return 2;
+        }
+
+        if(compareBaseline(baseline, metrics, tolerance) > 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
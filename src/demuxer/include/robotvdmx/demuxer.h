@@ -26,8 +26,11 @@
 #define ROBOTV_DEMUXER_H
 
 #include <stdint.h>
+#include <atomic>
 #include <list>
+#include <memory>
 #include "streaminfo.h"
+#include "tsstats.h"
 
 class Parser;
 
@@ -48,6 +51,10 @@ public:
 
         uint8_t* data = nullptr;
         int size = 0;
+
+        // owner of the payload memory (if any), a listener keeping a copy
+        // of it may use data beyond onStreamPacket()
+        std::shared_ptr<uint8_t> buffer;
     };
 
     class Listener {
@@ -67,6 +74,10 @@ private:
 
     Parser* m_pesParser;
 
+    std::atomic<uint32_t> m_overflowCount;
+
+    TsMonitor m_monitor;
+
     int64_t rescale(int64_t a);
 
 public:
@@ -77,7 +88,7 @@ public:
 
     virtual ~TsDemuxer();
 
-    bool processTsPacket(unsigned char* data) const;
+    bool processTsPacket(unsigned char* data);
 
     const char* getLanguage() const {
         return m_language;
@@ -146,10 +157,20 @@ public:
 
     uint8_t* getVideoDecoderVps(int& length);
 
+    /* Number of frames lost by parser buffer overflows */
+    uint32_t getOverflowCount() const {
+        return m_overflowCount;
+    }
+
+    /* Transport stream statistics (updated once per second) */
+    TsStats getStats() const;
+
 protected:
 
     void sendPacket(StreamPacket* pkt);
 
+    void bufferOverflow();
+
     friend class Parser;
 
 private:
@@ -30,6 +30,7 @@
 //#include "net/msgpacket.h"
 
 #include <list>
+#include <vector>
 
 class DemuxerBundle : public std::list<TsDemuxer*> {
 public:
@@ -44,18 +45,33 @@ public:
 
     void reorderStreams(const char* lang, StreamInfo::Type type);
 
+    std::list<TsDemuxer*> sortedStreams(const char* lang, StreamInfo::Type type) const;
+
     bool isReady() const;
 
     void updateFrom(StreamBundle* bundle);
 
+    // listener for demuxers created by updateFrom()
+    void setListener(TsDemuxer::Listener* listener) {
+        m_listener = listener;
+    }
+
     bool processTsPacket(uint8_t* packet) const;
 
+    // process all TS packets of a buffer, returns the number of packets
+    int processTsPackets(uint8_t* data, int length) const;
+
     //MsgPacket* createStreamChangePacket();
 
 protected:
 
+    void updatePidTable();
+
     TsDemuxer::Listener* m_listener = NULL;
 
+    // PID -> demuxer lookup table
+    std::vector<TsDemuxer*> m_pidTable;
+
 };
 
 #endif // ROBOTV_DEMUXERBUNDLE_H
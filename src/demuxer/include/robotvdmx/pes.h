@@ -105,13 +105,19 @@ inline int64_t PesGetDts(const uint8_t *p)
 
 // TS Constants
 
+#define TS_SYNC_BYTE          0x47
 #define TS_PAYLOAD_START      0x40
 #define TS_SIZE               188
+#define TS_MAX_PID            0x1FFF
 #define TS_ADAPT_FIELD_EXISTS 0x20
 #define TS_SCRAMBLING_CONTROL 0xC0
 #define TS_ERROR              0x80
 #define TS_PAYLOAD_EXISTS     0x10
 #define TS_PID_MASK_HI        0x1F
+#define TS_CONT_CNT_MASK      0x0F
+#define TS_ADAPT_DISCONT      0x80
+#define TS_ADAPT_PCR          0x10
+#define TS_PCR_WRAP           (0x200000000LL * 300)
 
 
 // TS Helper Functions
@@ -145,5 +151,28 @@ inline int TsPid(const uint8_t *p) {
     return (p[1] & TS_PID_MASK_HI) * 256 + p[2];
 }
 
+inline int TsContinuityCounter(const uint8_t *p) {
+    return p[3] & TS_CONT_CNT_MASK;
+}
+
+inline bool TsIsDiscontinuity(const uint8_t *p) {
+    return TsHasAdaptationField(p) && p[4] > 0 && (p[5] & TS_ADAPT_DISCONT);
+}
+
+inline bool TsHasPcr(const uint8_t *p) {
+    return TsHasAdaptationField(p) && p[4] >= 7 && (p[5] & TS_ADAPT_PCR);
+}
+
+// PCR in 27 MHz units
+inline int64_t TsGetPcr(const uint8_t *p) {
+    int64_t base = ((int64_t)p[6] << 25) |
+                   ((int64_t)p[7] << 17) |
+                   ((int64_t)p[8] <<  9) |
+                   ((int64_t)p[9] <<  1) |
+                   ((int64_t)p[10] >> 7);
+
+    return base * 300 + (((p[10] & 0x01) << 8) | p[11]);
+}
+
 #endif // ROBOTV_PES_H
 
@@ -0,0 +1,106 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_TSSTATS_H
+#define ROBOTV_TSSTATS_H
+
+#include <stdint.h>
+#include <mutex>
+
+/**
+ * Transport stream statistics of a single PID.
+ */
+
+struct TsStats {
+    uint64_t packets = 0;
+
+    uint32_t ccErrors = 0;
+
+    uint32_t teiErrors = 0;
+
+    uint32_t scrambled = 0;
+
+    uint32_t overflows = 0;
+
+    // rolling metrics of the last second
+    uint32_t bitRate = 0;       // bits/s
+
+    uint32_t pcrJitter = 0;     // peak-to-peak PCR arrival jitter in us
+
+    uint32_t pcrInterval = 0;   // maximum PCR distance in ms
+};
+
+/**
+ * Collects the statistics of a PID.
+ * process() is called for every packet by the demuxing thread. The results
+ * are published once per second and may be read from any thread.
+ */
+
+class TsMonitor {
+public:
+
+    void process(const uint8_t* data);
+
+    TsStats getStats() const;
+
+private:
+
+    void processPcr(const uint8_t* data, int64_t now);
+
+    void publish(int64_t now);
+
+    // hot counters (demuxing thread only)
+    TsStats m_counters;
+
+    int m_lastCc = -1;
+
+    int64_t m_lastPcr = -1;
+
+    // PCR / arrival time reference
+    int64_t m_refPcr = -1;
+
+    int64_t m_refTime = 0;
+
+    // current window
+    int64_t m_windowStart = 0;
+
+    uint64_t m_windowPackets = 0;
+
+    // arrival offset range of the window
+    int64_t m_minOffset = 0;
+
+    int64_t m_maxOffset = 0;
+
+    bool m_haveOffset = false;
+
+    int64_t m_maxInterval = 0;
+
+    // published statistics
+    TsStats m_stats;
+
+    mutable std::mutex m_mutex;
+
+};
+
+#endif // ROBOTV_TSSTATS_H
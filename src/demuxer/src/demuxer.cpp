@@ -39,12 +39,12 @@
 
 #define DVD_TIME_BASE 1000000
 
-TsDemuxer::TsDemuxer(TsDemuxer::Listener* streamer, const StreamInfo& info) : StreamInfo(info), m_streamer(streamer) {
+TsDemuxer::TsDemuxer(TsDemuxer::Listener* streamer, const StreamInfo& info) : StreamInfo(info), m_streamer(streamer), m_overflowCount(0) {
     m_pesParser = createParser(m_type);
     setContent();
 }
 
-TsDemuxer::TsDemuxer(TsDemuxer::Listener* streamer, StreamInfo::Type type, int pid) : StreamInfo(pid, type), m_streamer(streamer) {
+TsDemuxer::TsDemuxer(TsDemuxer::Listener* streamer, StreamInfo::Type type, int pid) : StreamInfo(pid, type), m_streamer(streamer), m_overflowCount(0) {
     m_pesParser = createParser(m_type);
 }
 
@@ -108,11 +108,24 @@ void TsDemuxer::sendPacket(StreamPacket* pkt) {
     m_streamer->onStreamPacket(pkt);
 }
 
-bool TsDemuxer::processTsPacket(unsigned char* data) const {
+void TsDemuxer::bufferOverflow() {
+    m_overflowCount++;
+}
+
+TsStats TsDemuxer::getStats() const {
+    TsStats stats = m_monitor.getStats();
+    stats.overflows = m_overflowCount;
+
+    return stats;
+}
+
+bool TsDemuxer::processTsPacket(unsigned char* data) {
     if(data == NULL) {
         return false;
     }
 
+    m_monitor.process(data);
+
     bool pusi  = TsPayloadStart(data);
 
     int bytes = TS_SIZE - TsPayloadOffset(data);
@@ -23,11 +23,12 @@
  */
 
 #include <string.h>
+#include <algorithm>
 
 #include "robotvdmx/demuxerbundle.h"
 #include "robotvdmx/pes.h"
 
-DemuxerBundle::DemuxerBundle(TsDemuxer::Listener* listener) : m_listener(listener) {
+DemuxerBundle::DemuxerBundle(TsDemuxer::Listener* listener) : m_listener(listener), m_pidTable(TS_MAX_PID + 1, NULL) {
 }
 
 DemuxerBundle::~DemuxerBundle() {
@@ -43,19 +44,42 @@ void DemuxerBundle::clear() {
     }
 
     std::list<TsDemuxer*>::clear();
+    updatePidTable();
 }
 
-TsDemuxer* DemuxerBundle::findDemuxer(int Pid) const {
+void DemuxerBundle::updatePidTable() {
+    std::fill(m_pidTable.begin(), m_pidTable.end(), (TsDemuxer*)NULL);
+
     for(auto i = begin(); i != end(); i++) {
-        if((*i) != NULL && (*i)->getPid() == Pid) {
-            return (*i);
+        if((*i) == NULL) {
+            continue;
+        }
+
+        int pid = (*i)->getPid();
+
+        // first demuxer of a pid wins
+        if(pid >= 0 && pid <= TS_MAX_PID && m_pidTable[pid] == NULL) {
+            m_pidTable[pid] = (*i);
         }
     }
+}
 
-    return NULL;
+TsDemuxer* DemuxerBundle::findDemuxer(int Pid) const {
+    if(Pid < 0 || Pid > TS_MAX_PID) {
+        return NULL;
+    }
+
+    return m_pidTable[Pid];
 }
 
 void DemuxerBundle::reorderStreams(const char* lang, StreamInfo::Type type) {
+    std::list<TsDemuxer*> streams = sortedStreams(lang, type);
+
+    std::list<TsDemuxer*>::clear();
+    splice(end(), streams);
+}
+
+std::list<TsDemuxer*> DemuxerBundle::sortedStreams(const char* lang, StreamInfo::Type type) const {
     std::map<uint32_t, TsDemuxer*> weight;
 
     // compute weights
@@ -121,14 +145,14 @@ void DemuxerBundle::reorderStreams(const char* lang, StreamInfo::Type type) {
         weight[w] = stream;
     }
 
-    // reorder streams on weight
-    int idx = 0;
-    std::list<TsDemuxer*>::clear();
+    // order streams on weight
+    std::list<TsDemuxer*> streams;
 
-    for(std::map<uint32_t, TsDemuxer*>::reverse_iterator i = weight.rbegin(); i != weight.rend(); i++, idx++) {
-        TsDemuxer* stream = i->second;
-        push_back(stream);
+    for(std::map<uint32_t, TsDemuxer*>::reverse_iterator i = weight.rbegin(); i != weight.rend(); i++) {
+        streams.push_back(i->second);
     }
+
+    return streams;
 }
 
 bool DemuxerBundle::isReady() const {
@@ -166,6 +190,8 @@ void DemuxerBundle::updateFrom(StreamBundle* bundle) {
 
         push_back(dmx);
     }
+
+    updatePidTable();
 }
 
 bool DemuxerBundle::processTsPacket(uint8_t* packet) const {
@@ -178,3 +204,19 @@ bool DemuxerBundle::processTsPacket(uint8_t* packet) const {
 
     return demuxer->processTsPacket(packet);
 }
+
+int DemuxerBundle::processTsPackets(uint8_t* data, int length) const {
+    int count = 0;
+
+    for(; length >= TS_SIZE; data += TS_SIZE, length -= TS_SIZE) {
+        // skip broken packets
+        if(*data != TS_SYNC_BYTE) {
+            continue;
+        }
+
+        processTsPacket(data);
+        count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,106 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "chunkpool.h"
+
+// smallest chunk (4 KB) and largest pooled chunk (8 MB)
+#define CHUNK_MIN_CLASS 12
+#define CHUNK_MAX_CLASS 23
+
+// free chunks kept per size class (large classes are limited to 8 MB)
+#define CHUNK_MAX_FREE 16
+#define CHUNK_MAX_FREE_BYTES (8 * 1024 * 1024)
+
+ChunkPool::ChunkPool() : m_free(CHUNK_MAX_CLASS - CHUNK_MIN_CLASS + 1) {
+}
+
+ChunkPool::~ChunkPool() {
+    for(auto& c : m_free) {
+        for(auto p : c) {
+            ::free(p);
+        }
+    }
+}
+
+ChunkPool& ChunkPool::instance() {
+    static ChunkPool pool;
+    return pool;
+}
+
+int ChunkPool::sizeClass(int capacity) {
+    int c = CHUNK_MIN_CLASS;
+
+    while(c < CHUNK_MAX_CLASS && (1 << c) < capacity) {
+        c++;
+    }
+
+    return c;
+}
+
+uint8_t* ChunkPool::acquire(int size, int& capacity) {
+    int c = sizeClass(size);
+
+    // oversized chunks aren't pooled
+    if((1 << c) < size) {
+        capacity = size;
+        return (uint8_t*)malloc(size);
+    }
+
+    capacity = 1 << c;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<uint8_t*>& list = m_free[c - CHUNK_MIN_CLASS];
+
+        if(!list.empty()) {
+            uint8_t* p = list.back();
+            list.pop_back();
+            return p;
+        }
+    }
+
+    return (uint8_t*)malloc(capacity);
+}
+
+void ChunkPool::release(uint8_t* chunk, int capacity) {
+    int c = sizeClass(capacity);
+
+    if((1 << c) == capacity) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<uint8_t*>& list = m_free[c - CHUNK_MIN_CLASS];
+
+        int maxFree = std::max(1, std::min(CHUNK_MAX_FREE, CHUNK_MAX_FREE_BYTES >> c));
+
+        if((int)list.size() < maxFree) {
+            list.push_back(chunk);
+            return;
+        }
+    }
+
+    ::free(chunk);
+}
@@ -0,0 +1,63 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_DEMUXER_CHUNKPOOL_H
+#define ROBOTV_DEMUXER_CHUNKPOOL_H
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+/**
+ * Shared arena for parser buffers.
+ * Chunks are recycled in power of two size classes between all demuxers.
+ */
+
+class ChunkPool {
+public:
+
+    static ChunkPool& instance();
+
+    // get a chunk of at least size bytes (capacity is the real size)
+    uint8_t* acquire(int size, int& capacity);
+
+    void release(uint8_t* chunk, int capacity);
+
+protected:
+
+    ChunkPool();
+
+    ~ChunkPool();
+
+private:
+
+    static int sizeClass(int capacity);
+
+    std::vector<std::vector<uint8_t*>> m_free;
+
+    std::mutex m_mutex;
+
+};
+
+#endif // ROBOTV_DEMUXER_CHUNKPOOL_H
@@ -22,16 +22,21 @@
  *
  */
 
+#include <algorithm>
+
 #include "robotvdmx/pes.h"
 
 #include "parser.h"
+#include "scanner.h"
 
-Parser::Parser(TsDemuxer* demuxer, int buffersize, int packetsize) : RingBuffer(buffersize, packetsize), m_demuxer(demuxer), m_startup(true) {
+Parser::Parser(TsDemuxer* demuxer, int buffersize, int packetsize) : RingBuffer(buffersize, packetsize, 4 * buffersize), m_demuxer(demuxer), m_startup(true) {
     m_sampleRate = 0;
     m_bitRate = 0;
     m_channels = 0;
     m_duration = 0;
     m_headerSize = 0;
+    m_syncWord = 0;
+    m_syncMask = 0;
     m_frameType = StreamInfo::FrameType::UNKNOWN;
 
     m_curPts = DVD_NOPTS_VALUE;
@@ -75,10 +80,15 @@ void Parser::sendPayload(unsigned char* payload, int length) {
     pkt.dts = m_curDts;
     pkt.pts = m_curPts;
     pkt.frameType = m_frameType;
+    pkt.buffer = m_payloadBuffer;
 
     m_demuxer->sendPacket(&pkt);
 }
 
+void Parser::bufferOverflow() {
+    m_demuxer->bufferOverflow();
+}
+
 void Parser::putData(unsigned char* data, int length, bool pusi) {
     // get PTS / DTS on PES start
     if(pusi) {
@@ -96,6 +106,7 @@ void Parser::putData(unsigned char* data, int length, bool pusi) {
         // reset buffer on overflow
         if(bytesPut < length) {
             clear();
+            bufferOverflow();
         }
     }
 }
@@ -164,13 +175,28 @@ int Parser::parsePayload(unsigned char* payload, int length) {
 int Parser::findAlignmentOffset(unsigned char* buffer, int buffersize, int o, int& framesize) {
     framesize = 0;
 
+    int limit = buffersize - m_headerSize;
+
     // seek sync
-    while(o < (buffersize - m_headerSize) && !checkAlignmentHeader(buffer + o, framesize, false)) {
+    while(o < limit) {
+        // skip to the next sync word candidate
+        if(m_syncMask != 0) {
+            o = scanSyncWord(buffer, std::min(limit + 1, buffersize), o, m_syncWord, m_syncMask);
+
+            if(o == -1) {
+                return -1;
+            }
+        }
+
+        if(checkAlignmentHeader(buffer + o, framesize, false)) {
+            break;
+        }
+
         o++;
     }
 
     // not found
-    if(o >= buffersize - m_headerSize || framesize <= 0) {
+    if(o >= limit || framesize <= 0) {
         return -1;
     }
 
@@ -183,6 +209,44 @@ bool Parser::checkAlignmentHeader(unsigned char* buffer, int& framesize, bool pa
 }
 
 int Parser::findStartCode(unsigned char* buffer, int buffersize, int offset, uint32_t startcode, uint32_t mask) {
+    // distance from a "00 00 01" prefix to the end of the 4 byte window
+    int windowEnd = -1;
+
+    if((mask & 0x00FFFFFF) == 0x00FFFFFF && (startcode & 0x00FFFFFF) == 0x000001) {
+        windowEnd = 2;
+    }
+    else if((mask & 0xFFFFFF00) == 0xFFFFFF00 && (startcode & 0xFFFFFF00) == 0x00000100) {
+        windowEnd = 3;
+    }
+
+    // scan for prefix candidates and verify the whole window
+    if(windowEnd != -1) {
+        int p = offset;
+
+        while((p = scanStartCodePrefix(buffer, buffersize, p)) >= 0) {
+            int e = p + windowEnd;
+
+            if(e >= buffersize) {
+                break;
+            }
+
+            uint32_t sc = 0;
+
+            // bytes before offset haven't been shifted in
+            for(int i = e - 3; i <= e; i++) {
+                sc = (sc << 8) | (i >= offset ? buffer[i] : 0xFF);
+            }
+
+            if((uint32_t)(sc & mask) == startcode) {
+                return e - 3;
+            }
+
+            p++;
+        }
+
+        return -1;
+    }
+
     uint32_t sc = 0xFFFFFFFF;
 
     while(offset < buffersize) {
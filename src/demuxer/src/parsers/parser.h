@@ -43,6 +43,9 @@ protected:
 
     virtual void sendPayload(unsigned char* payload, int length);
 
+    // a frame was lost because the buffer was full
+    void bufferOverflow();
+
     virtual int parsePayload(unsigned char* payload, int length);
 
     virtual bool checkAlignmentHeader(unsigned char* buffer, int& framesize, bool parse);
@@ -65,8 +68,16 @@ protected:
 
     int m_headerSize;
 
+    // sync word (and mask) to scan for before checking the alignment header
+    uint16_t m_syncWord;
+
+    uint16_t m_syncMask;
+
     StreamInfo::FrameType m_frameType;
 
+    // owner of the payload passed to sendPayload() (optional)
+    std::shared_ptr<uint8_t> m_payloadBuffer;
+
     bool m_startup;
 
 private:
@@ -30,6 +30,8 @@
 
 ParserAc3::ParserAc3(TsDemuxer* demuxer) : Parser(demuxer, 64 * 1024, 4096) {
     m_headerSize = AC3_HEADER_SIZE;
+    m_syncWord = 0x0B77;
+    m_syncMask = 0xFFFF;
     m_enhanced = false;
 }
 
@@ -29,6 +29,8 @@
 
 ParserAdts::ParserAdts(TsDemuxer* demuxer) : Parser(demuxer, 64 * 1024, 8192) {
     m_headerSize = 9; // header is 9 bytes long (with CRC)
+    m_syncWord = 0xFFF0;
+    m_syncMask = 0xFFF0;
 }
 
 bool ParserAdts::ParseAudioHeader(uint8_t* buffer, int& channels, int& samplerate, int& framesize) {
@@ -71,28 +71,19 @@ int32_t ParserH264::readGolombSe(BitStream* bs) {
 }
 
 
-ParserH264::ParserH264(TsDemuxer* demuxer) : ParserPes(demuxer, 512 * 1024) {
+ParserH264::ParserH264(TsDemuxer* demuxer) : ParserPes(demuxer, 8 * 1024 * 1024) {
     m_scale = 0;
     m_rate = 0;
 }
 
-uint8_t* ParserH264::extractNal(uint8_t* packet, int length, int nal_offset, int& nal_len) {
+int ParserH264::nalLength(uint8_t* packet, int length, int nal_offset) {
     int e = findStartCode(packet, length, nal_offset, 0x00000001);
 
     if(e == -1) {
         e = length;
     }
 
-    int l = e - nal_offset;
-
-    if(l <= 0) {
-        return NULL;
-    }
-
-    uint8_t* nal_data = new uint8_t[l];
-    nal_len = nalUnescape(nal_data, packet + nal_offset, l);
-
-    return nal_data;
+    return e - nal_offset;
 }
 
 int ParserH264::parsePayload(unsigned char* data, int length) {
@@ -121,12 +112,7 @@ int ParserH264::parsePayload(unsigned char* data, int length) {
         // NAL_SLH
         if(nal_type == NAL_SLH && length - o > 1) {
             o++;
-            uint8_t* nal_data = extractNal(data, length, o, nal_len);
-
-            if(nal_data != NULL) {
-                parseSlh(nal_data, nal_len);
-                delete[] nal_data;
-            }
+            parseSlh(data + o, length - o);
         }
 
         // NAL_PPS
@@ -147,13 +133,16 @@ int ParserH264::parsePayload(unsigned char* data, int length) {
         }
     }
 
-    // extract and register PPS data (decoder specific data)
+    uint8_t nal_data[NAL_MAX_DECODER_DATA];
+    int currentLength = 0;
+
+    // register changed PPS data (decoder specific data)
     if(pps_start != -1) {
-        uint8_t* pps_data = extractNal(data, length, pps_start, nal_len);
+        uint8_t* current = m_demuxer->getVideoDecoderPps(currentLength);
+        nal_len = changedNal(nal_data, sizeof(nal_data), data + pps_start, nalLength(data, length, pps_start), current, currentLength);
 
-        if(pps_data != NULL) {
-            m_demuxer->setVideoDecoderData(NULL, 0, pps_data, nal_len);
-            delete[] pps_data;
+        if(nal_len > 0) {
+            m_demuxer->setVideoDecoderData(NULL, 0, nal_data, nal_len);
         }
     }
 
@@ -162,10 +151,9 @@ int ParserH264::parsePayload(unsigned char* data, int length) {
         return length;
     }
 
-    // extract SPS
-    uint8_t* nal_data = extractNal(data, length, sps_start, nal_len);
+    int sps_len = nalLength(data, length, sps_start);
 
-    if(nal_data == NULL) {
+    if(sps_len <= 0) {
         return length;
     }
 
@@ -175,8 +163,13 @@ int ParserH264::parsePayload(unsigned char* data, int length) {
         m_frameType = StreamInfo::FrameType::IFRAME;
     }
 
-    // register SPS data (decoder specific data)
-    m_demuxer->setVideoDecoderData(nal_data, nal_len, NULL, 0);
+    // register changed SPS data (decoder specific data)
+    uint8_t* current = m_demuxer->getVideoDecoderSps(currentLength);
+    nal_len = changedNal(nal_data, sizeof(nal_data), data + sps_start, sps_len, current, currentLength);
+
+    if(nal_len > 0) {
+        m_demuxer->setVideoDecoderData(nal_data, nal_len, NULL, 0);
+    }
 
     int width = 0;
     int height = 0;
@@ -187,10 +180,7 @@ int ParserH264::parsePayload(unsigned char* data, int length) {
         m_frameType = StreamInfo::FrameType::IFRAME;
     }
 
-    bool rc = parseSps(nal_data, nal_len, pixelaspect, width, height);
-    delete[] nal_data;
-
-    if(!rc) {
+    if(!parseSps(data + sps_start, sps_len, pixelaspect, width, height)) {
         return length;
     }
 
@@ -201,7 +191,7 @@ int ParserH264::parsePayload(unsigned char* data, int length) {
     return length;
 }
 
-int ParserH264::nalUnescape(uint8_t* dst, const uint8_t* src, int len) {
+bool ParserH264::nalEqual(const uint8_t* src, int len, const uint8_t* data, int dataLength) {
     int s = 0, d = 0;
 
     while(s < len) {
@@ -212,14 +202,50 @@ int ParserH264::nalUnescape(uint8_t* dst, const uint8_t* src, int len) {
             }
         }
 
+        if(d >= dataLength || data[d++] != src[s++]) {
+            return false;
+        }
+    }
+
+    return (d == dataLength);
+}
+
+int ParserH264::nalUnescape(uint8_t* dst, int maxLength, const uint8_t* src, int len) {
+    int s = 0, d = 0;
+
+    while(s < len) {
+        if(s >= 2 && s < len - 1) {
+            // hit 00 00 03 ?
+            if(src[s - 2] == 0 && src[s - 1] == 0 && src[s] == 3) {
+                s++; // skip 03
+            }
+        }
+
+        if(d >= maxLength) {
+            return -1;
+        }
+
         dst[d++] = src[s++];
     }
 
     return d;
 }
 
+int ParserH264::changedNal(uint8_t* dst, int maxLength, const uint8_t* src, int len, const uint8_t* current, int currentLength) {
+    if(len <= 0) {
+        return -1;
+    }
+
+    // unchanged
+    if(current != NULL && nalEqual(src, len, current, currentLength)) {
+        return -1;
+    }
+
+    return nalUnescape(dst, maxLength, src, len);
+}
+
 void ParserH264::parseSlh(uint8_t* buf, int len) {
-    BitStream bs(buf, len * 8);
+    BitStream bs(buf, len * 8, true);
 
     readGolombUe(&bs); // first_mb_in_slice
     int type = readGolombUe(&bs);;
@@ -251,7 +277,7 @@ void ParserH264::parseSlh(uint8_t* buf, int len) {
 
 bool ParserH264::parseSps(uint8_t* buf, int len, pixel_aspect_t& pixelaspect, int& width, int& height) {
     bool seq_scaling_matrix_present = false;
-    BitStream bs(buf, len * 8);
+    BitStream bs(buf, len * 8, true);
 
     int profile_idc = bs.getBits(8); // profile idc
 
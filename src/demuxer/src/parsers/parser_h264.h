@@ -28,6 +28,9 @@
 #include <upstream/bitstream.h>
 #include "parser_pes.h"
 
+// maximum size of decoder data (SPS / PPS / VPS) stored in the demuxer
+#define NAL_MAX_DECODER_DATA 128
+
 class ParserH264 : public ParserPes {
 public:
 
@@ -45,9 +48,13 @@ protected:
     // pixel aspect ratios
     static const pixel_aspect_t m_aspect_ratios[17];
 
-    uint8_t* extractNal(uint8_t* packet, int length, int nal_offset, int& nal_len);
+    int nalLength(uint8_t* packet, int length, int nal_offset);
+
+    bool nalEqual(const uint8_t* src, int len, const uint8_t* data, int dataLength);
+
+    int nalUnescape(uint8_t* dst, int maxLength, const uint8_t* src, int len);
 
-    int nalUnescape(uint8_t* dst, const uint8_t* src, int len);
+    int changedNal(uint8_t* dst, int maxLength, const uint8_t* src, int len, const uint8_t* current, int currentLength);
 
     uint32_t readGolombUe(BitStream* bs);
 
@@ -22,12 +22,15 @@
  *
  */
 
+#include <string.h>
+
 #include "parser_h265.h"
 
 // nal_unit_type values from H.265/HEVC (2014) Table 7-1.
 #define RASL_R   9
 #define BLA_W_LP 16
 #define CRA_NUT  21
+#define RSV_IRAP_VCL23 23
 #define VPS_NUT  32
 #define SPS_NUT  33
 #define PPS_NUT  34
@@ -37,12 +40,15 @@
 #define SUFFIX_SEI_NUT 40
 
 ParserH265::ParserH265(TsDemuxer* demuxer) : ParserH264(demuxer) {
+    memset(m_extraSliceHeaderBits, 0, sizeof(m_extraSliceHeaderBits));
 }
 
 int ParserH265::parsePayload(unsigned char* data, int length) {
     int o = 0;
     int sps_start = -1;
     int nal_len = 0;
+    int currentLength = 0;
+    uint8_t nal_data[NAL_MAX_DECODER_DATA];
 
     m_frameType = StreamInfo::FrameType::UNKNOWN;
 
@@ -65,25 +71,31 @@ int ParserH265::parsePayload(unsigned char* data, int length) {
             m_frameType = StreamInfo::FrameType::IFRAME;
         }
 
+        // slice segment
+        if(nal_type < VPS_NUT && length - o > 2) {
+            parseSliceHeader(data + o + 2, length - o - 2, nal_type);
+        }
+
         // PPS_NUT
-        if(nal_type == PPS_NUT && length - o > 1) {
+        else if(nal_type == PPS_NUT && length - o > 1) {
             o++;
-            uint8_t* pps_data = extractNal(data, length, o, nal_len);
+            parsePps(data + o + 1, length - o - 1);
+            uint8_t* current = m_demuxer->getVideoDecoderPps(currentLength);
+            nal_len = changedNal(nal_data, sizeof(nal_data), data + o, nalLength(data, length, o), current, currentLength);
 
-            if(pps_data != NULL) {
-                m_demuxer->setVideoDecoderData(NULL, 0, pps_data, nal_len);
-                delete[] pps_data;
+            if(nal_len > 0) {
+                m_demuxer->setVideoDecoderData(NULL, 0, nal_data, nal_len);
             }
         }
 
         // VPS_NUT
         else if(nal_type == VPS_NUT && length - o > 1) {
             o++;
-            uint8_t* vps_data = extractNal(data, length, o, nal_len);
+            uint8_t* current = m_demuxer->getVideoDecoderVps(currentLength);
+            nal_len = changedNal(nal_data, sizeof(nal_data), data + o, nalLength(data, length, o), current, currentLength);
 
-            if(vps_data != NULL) {
-                m_demuxer->setVideoDecoderData(NULL, 0, NULL, 0, vps_data, nal_len);
-                delete[] vps_data;
+            if(nal_len > 0) {
+                m_demuxer->setVideoDecoderData(NULL, 0, NULL, 0, nal_data, nal_len);
             }
         }
 
@@ -99,24 +111,25 @@ int ParserH265::parsePayload(unsigned char* data, int length) {
         return length;
     }
 
-    // extract SPS
-    uint8_t* nal_data = extractNal(data, length, sps_start, nal_len);
+    int sps_len = nalLength(data, length, sps_start);
 
-    if(nal_data == NULL) {
+    if(sps_len <= 0) {
         return length;
     }
 
-    // register SPS data (decoder specific data)
-    m_demuxer->setVideoDecoderData(nal_data, nal_len, NULL, 0);
+    // register changed SPS data (decoder specific data)
+    uint8_t* current = m_demuxer->getVideoDecoderSps(currentLength);
+    nal_len = changedNal(nal_data, sizeof(nal_data), data + sps_start, sps_len, current, currentLength);
+
+    if(nal_len > 0) {
+        m_demuxer->setVideoDecoderData(nal_data, nal_len, NULL, 0);
+    }
 
     int width = 0;
     int height = 0;
     pixel_aspect_t pixelaspect = { 1, 1 };
 
-    bool rc = parseSps(nal_data, nal_len, pixelaspect, width, height);
-    delete[] nal_data;
-
-    if(!rc) {
+    if(!parseSps(data + sps_start, sps_len, pixelaspect, width, height)) {
         return length;
     }
 
@@ -130,6 +143,66 @@ int ParserH265::parsePayload(unsigned char* data, int length) {
     return length;
 }
 
+void ParserH265::parsePps(uint8_t* buf, int len) {
+    BitStream bs(buf, len * 8, true);
+
+    uint32_t ppsId = readGolombUe(&bs); // pps_pic_parameter_set_id
+    readGolombUe(&bs); // pps_seq_parameter_set_id
+    bs.skipBits(1); // dependent_slice_segments_enabled_flag
+    bs.skipBits(1); // output_flag_present_flag
+
+    if(ppsId < sizeof(m_extraSliceHeaderBits)) {
+        m_extraSliceHeaderBits[ppsId] = bs.getBits(3); // num_extra_slice_header_bits
+    }
+}
+
+void ParserH265::parseSliceHeader(uint8_t* buf, int len, int nalType) {
+    BitStream bs(buf, len * 8, true);
+
+    // only the first segment of a picture is parsed (no PPS / SPS dependencies)
+    if(!bs.getBit()) { // first_slice_segment_in_pic_flag
+        return;
+    }
+
+    if(nalType >= BLA_W_LP && nalType <= RSV_IRAP_VCL23) {
+        bs.skipBits(1); // no_output_of_prior_pics_flag
+    }
+
+    uint32_t ppsId = readGolombUe(&bs); // slice_pic_parameter_set_id
+
+    if(ppsId >= sizeof(m_extraSliceHeaderBits)) {
+        return;
+    }
+
+    bs.skipBits(m_extraSliceHeaderBits[ppsId]); // slice_reserved_flag[i]
+
+    StreamInfo::FrameType frameType;
+
+    switch(readGolombUe(&bs)) { // slice_type
+        case 0:
+            frameType = StreamInfo::FrameType::BFRAME;
+            break;
+
+        case 1:
+            frameType = StreamInfo::FrameType::PFRAME;
+            break;
+
+        case 2:
+            frameType = StreamInfo::FrameType::IFRAME;
+            break;
+
+        default:
+            return;
+    }
+
+    // multiple pictures in a packet: B before P before I
+    if(m_frameType == StreamInfo::FrameType::UNKNOWN ||
+            frameType == StreamInfo::FrameType::BFRAME ||
+            (frameType == StreamInfo::FrameType::PFRAME && m_frameType == StreamInfo::FrameType::IFRAME)) {
+        m_frameType = frameType;
+    }
+}
+
 void ParserH265::skipScalingList(BitStream& bs) {
     for(int sizeId = 0; sizeId < 4; sizeId++) {
         for(int matrixId = 0; matrixId < 6; matrixId += sizeId == 3 ? 3 : 1) {
@@ -194,7 +267,7 @@ void ParserH265::skipShortTermRefPicSets(BitStream& bs) {
 }
 
 bool ParserH265::parseSps(uint8_t* buf, int len, pixel_aspect_t& pixelaspect, int& width, int& height) {
-    BitStream bs(buf, len * 8);
+    BitStream bs(buf, len * 8, true);
     bs.skipBits(8 + 4); // NAL header, sps_video_parameter_set_id
     int maxSubLayersMinus1 = bs.getBits(3);
     bs.skipBits(1); // sps_temporal_id_nesting_flag
@@ -36,12 +36,19 @@ public:
 
 private:
 
+    void parsePps(uint8_t* buf, int len);
+
+    void parseSliceHeader(uint8_t* buf, int len, int nalType);
+
     void skipScalingList(BitStream& bs);
 
     void skipShortTermRefPicSets(BitStream& bs);
 
     bool parseSps(uint8_t* buf, int len, pixel_aspect_t& pixel_aspect, int& width, int& height);
 
+    // num_extra_slice_header_bits of each PPS
+    uint8_t m_extraSliceHeaderBits[64];
+
 };
 
 
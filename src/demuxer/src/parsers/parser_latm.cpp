@@ -28,6 +28,8 @@
 #include "parser_latm.h"
 
 ParserLatm::ParserLatm(TsDemuxer* demuxer) : Parser(demuxer, 64 * 1024, 8192) { //, m_framelength(0)
+    m_syncWord = 0x56E0; // 0x2B7 (11 bits)
+    m_syncMask = 0xFFE0;
 }
 
 bool ParserLatm::checkAlignmentHeader(unsigned char* buffer, int& framesize, bool parse) {
@@ -51,6 +51,8 @@ const int SlotSizes[3] = { 4, 1, 1 };
 
 ParserMpeg2Audio::ParserMpeg2Audio(TsDemuxer* demuxer) : Parser(demuxer, 64 * 1024, 2048) {
     m_headerSize = 4;
+    m_syncWord = 0xFFE0;
+    m_syncMask = 0xFFE0;
 }
 
 bool ParserMpeg2Audio::parseAudioHeader(uint8_t* buffer, int& channels, int& samplerate, int& bitrate, int& framesize) {
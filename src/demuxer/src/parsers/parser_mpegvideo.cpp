@@ -75,7 +75,7 @@ static StreamInfo::FrameType ConvertFrameType(int frametype) {
     return StreamInfo::FrameType::UNKNOWN;
 }
 
-ParserMpeg2Video::ParserMpeg2Video(TsDemuxer* demuxer) : ParserPes(demuxer, 512 * 1024), m_frameDifference(0), m_lastDts(DVD_NOPTS_VALUE) {
+ParserMpeg2Video::ParserMpeg2Video(TsDemuxer* demuxer) : ParserPes(demuxer, 8 * 1024 * 1024), m_frameDifference(0), m_lastDts(DVD_NOPTS_VALUE) {
 }
 
 StreamInfo::FrameType ParserMpeg2Video::parsePicture(unsigned char* data, int length) {
@@ -26,7 +26,7 @@
 
 #include "parser_pes.h"
 
-ParserPes::ParserPes(TsDemuxer* demuxer, int buffersize) : Parser(demuxer, buffersize, 0), m_length(0) {
+ParserPes::ParserPes(TsDemuxer* demuxer, int buffersize) : Parser(demuxer, 0, 0), m_length(0), m_buffer(buffersize), m_overflow(false) {
     m_startup = true;
 }
 
@@ -34,20 +34,23 @@ void ParserPes::parse(unsigned char* data, int size, bool pusi) {
 
     // packet completely assembled ?
     if(!m_startup) {
-        int length = 0;
-        uint8_t* buffer = get(length);
+        int length = m_buffer.available();
 
-        if(((length >= m_length && m_length != 0) || (m_length == 0 && pusi)) && buffer != NULL) {
+        if(((length >= m_length && m_length != 0) || (m_length == 0 && pusi)) && length > 0) {
             // get buffer size for packets with undefined length
             if(m_length == 0) {
-                m_length = available();
+                m_length = length;
             }
 
+            uint8_t* buffer = m_buffer.get(m_length);
+
             // parse payload
             int len = parsePayload(buffer, m_length);
 
-            // send payload data
+            // send payload data, listeners may keep the assembled packet
+            m_payloadBuffer = m_buffer.detach(buffer);
             sendPayload(buffer, len);
+            m_payloadBuffer.reset();
 
             m_curDts = DVD_NOPTS_VALUE;
             m_curPts = DVD_NOPTS_VALUE;
@@ -71,11 +74,15 @@ void ParserPes::parse(unsigned char* data, int size, bool pusi) {
         m_startup = false;
 
         // reset buffer
-        clear();
+        m_buffer.clear();
+        m_buffer.reserve(m_length);
+        m_overflow = false;
     }
 
     // we start with the beginning of a packet
-    if(!m_startup) {
-        put(data, size);
+    if(!m_startup && m_buffer.put(data, size) < size && !m_overflow) {
+        // count a truncated packet only once
+        m_overflow = true;
+        bufferOverflow();
     }
 }
@@ -26,6 +26,7 @@
 #define ROBOTV_DEMUXER_PES_H
 
 #include "parser.h"
+#include "pesbuffer.h"
 
 class ParserPes : public Parser {
 public:
@@ -38,6 +39,12 @@ protected:
 
     int m_length;
 
+    PesBuffer m_buffer;
+
+private:
+
+    bool m_overflow;
+
 };
 
 #endif // ROBOTV_DEMUXER_PES_H
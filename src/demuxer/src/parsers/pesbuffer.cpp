@@ -0,0 +1,153 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "pesbuffer.h"
+
+// linearised packets of the current thread
+static thread_local std::vector<uint8_t> scratch;
+
+PesBuffer::PesBuffer(int maxSize) : m_maxSize(maxSize) {
+}
+
+PesBuffer::~PesBuffer() {
+    clear();
+}
+
+void PesBuffer::updateSizeHint() {
+    // adapt to the packet sizes (slowly decaying maximum)
+    m_sizeHint = std::max(m_length, m_sizeHint - m_sizeHint / 8);
+}
+
+void PesBuffer::clear() {
+    // nothing assembled since the last detach()
+    if(m_segments.empty()) {
+        m_length = 0;
+        return;
+    }
+
+    updateSizeHint();
+
+    for(auto& s : m_segments) {
+        ChunkPool::instance().release(s.data, s.capacity);
+    }
+
+    m_segments.clear();
+    m_length = 0;
+}
+
+void PesBuffer::reserve(int size) {
+    if(m_segments.empty() && size > 0) {
+        addSegment(std::min(size, m_maxSize));
+    }
+}
+
+void PesBuffer::addSegment(int size) {
+    Segment s;
+    s.data = ChunkPool::instance().acquire(size, s.capacity);
+    s.used = 0;
+
+    m_segments.push_back(s);
+}
+
+int PesBuffer::put(const uint8_t* data, int count) {
+    // packets grow on demand up to the hard limit
+    count = std::min(count, m_maxSize - m_length);
+
+    if(count <= 0) {
+        return 0;
+    }
+
+    int rest = count;
+
+    while(rest > 0) {
+        if(m_segments.empty() || m_segments.back().used == m_segments.back().capacity) {
+            addSegment(std::max(rest, m_segments.empty() ? m_sizeHint : m_length));
+        }
+
+        Segment& s = m_segments.back();
+        int n = std::min(rest, s.capacity - s.used);
+
+        memcpy(s.data + s.used, data, n);
+        s.used += n;
+        data += n;
+        rest -= n;
+    }
+
+    m_length += count;
+    return count;
+}
+
+uint8_t* PesBuffer::get(int length) {
+    if(m_segments.empty() || length <= 0) {
+        return nullptr;
+    }
+
+    length = std::min(length, m_length);
+
+    // already contiguous
+    if(length <= m_segments.front().used) {
+        return m_segments.front().data;
+    }
+
+    // linearise
+    if((int)scratch.size() < length) {
+        scratch.resize(length);
+    }
+
+    int offset = 0;
+
+    for(auto& s : m_segments) {
+        int n = std::min(s.used, length - offset);
+        memcpy(scratch.data() + offset, s.data, n);
+        offset += n;
+
+        if(offset == length) {
+            break;
+        }
+    }
+
+    return scratch.data();
+}
+
+std::shared_ptr<uint8_t> PesBuffer::detach(uint8_t* data) {
+    if(m_segments.empty() || data != m_segments.front().data) {
+        return nullptr;
+    }
+
+    updateSizeHint();
+
+    std::vector<Segment> segments;
+    segments.swap(m_segments);
+    m_length = 0;
+
+    return std::shared_ptr<uint8_t>(data, [segments](uint8_t*) {
+        for(auto& s : segments) {
+            ChunkPool::instance().release(s.data, s.capacity);
+        }
+    });
+}
@@ -0,0 +1,94 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_DEMUXER_PESBUFFER_H
+#define ROBOTV_DEMUXER_PESBUFFER_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "chunkpool.h"
+
+/**
+ * Scatter-gather buffer for a single PES packet.
+ *
+ * TS payloads are appended to a chain of pooled chunks. The buffer is only
+ * linearised if a packet spans more than one chunk. The size of the first
+ * chunk adapts to the recent packet sizes, so that usually doesn't happen.
+ * Chunks go back to the pool with every packet, so large frames (UHD) only
+ * hold memory while they are assembled.
+ */
+
+class PesBuffer {
+public:
+
+    // maxSize is the hard limit of a single packet
+    PesBuffer(int maxSize);
+
+    ~PesBuffer();
+
+    // release all data (start of a new packet)
+    void clear();
+
+    // expected size of the next packet
+    void reserve(int size);
+
+    int put(const uint8_t* data, int count);
+
+    int available() const {
+        return m_length;
+    }
+
+    // contiguous view of the first length bytes
+    uint8_t* get(int length);
+
+    // hand over the chunks of the packet returned by get(), they go back
+    // to the pool when the last reference is dropped. returns an empty
+    // pointer (and keeps the chunks) for linearised packets.
+    std::shared_ptr<uint8_t> detach(uint8_t* data);
+
+private:
+
+    struct Segment {
+        uint8_t* data;
+        int capacity;
+        int used;
+    };
+
+    void addSegment(int size);
+
+    void updateSizeHint();
+
+    std::vector<Segment> m_segments;
+
+    int m_length = 0;
+
+    int m_maxSize;
+
+    int m_sizeHint = 0;
+
+};
+
+#endif // ROBOTV_DEMUXER_PESBUFFER_H
@@ -0,0 +1,222 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCANNER_X86
+#include <immintrin.h>
+#endif
+
+typedef int (*StartCodeScanner)(const uint8_t*, int, int);
+typedef int (*SyncWordScanner)(const uint8_t*, int, int, uint16_t, uint16_t);
+
+static int scanStartCodePrefixScalar(const uint8_t* buffer, int size, int offset) {
+    for(int i = offset; i + 2 < size; i++) {
+        // a start code can't begin before the next zero byte
+        if(buffer[i + 2] > 1) {
+            i += 2;
+            continue;
+        }
+
+        if(buffer[i] == 0 && buffer[i + 1] == 0 && buffer[i + 2] == 1) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static int scanSyncWordScalar(const uint8_t* buffer, int size, int offset, uint16_t pattern, uint16_t mask) {
+    uint8_t hiPattern = pattern >> 8;
+    uint8_t hiMask = mask >> 8;
+    uint8_t loPattern = pattern & 0xFF;
+    uint8_t loMask = mask & 0xFF;
+
+    for(int i = offset; i + 1 < size; i++) {
+        if((buffer[i] & hiMask) == hiPattern && (buffer[i + 1] & loMask) == loPattern) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef SCANNER_X86
+
+__attribute__((target("sse2")))
+static int scanStartCodePrefixSse2(const uint8_t* buffer, int size, int offset) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    int i = offset;
+
+    for(; i + 2 + 16 <= size; i += 16) {
+        __m128i b0 = _mm_loadu_si128((const __m128i*)(buffer + i));
+        __m128i b1 = _mm_loadu_si128((const __m128i*)(buffer + i + 1));
+        __m128i b2 = _mm_loadu_si128((const __m128i*)(buffer + i + 2));
+
+        __m128i m = _mm_and_si128(
+                        _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+                        _mm_cmpeq_epi8(b2, one));
+
+        int bits = _mm_movemask_epi8(m);
+
+        if(bits != 0) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+
+    return scanStartCodePrefixScalar(buffer, size, i);
+}
+
+__attribute__((target("sse2")))
+static int scanSyncWordSse2(const uint8_t* buffer, int size, int offset, uint16_t pattern, uint16_t mask) {
+    const __m128i hiPattern = _mm_set1_epi8((char)(pattern >> 8));
+    const __m128i hiMask = _mm_set1_epi8((char)(mask >> 8));
+    const __m128i loPattern = _mm_set1_epi8((char)(pattern & 0xFF));
+    const __m128i loMask = _mm_set1_epi8((char)(mask & 0xFF));
+    int i = offset;
+
+    for(; i + 1 + 16 <= size; i += 16) {
+        __m128i b0 = _mm_loadu_si128((const __m128i*)(buffer + i));
+        __m128i b1 = _mm_loadu_si128((const __m128i*)(buffer + i + 1));
+
+        __m128i m = _mm_and_si128(
+                        _mm_cmpeq_epi8(_mm_and_si128(b0, hiMask), hiPattern),
+                        _mm_cmpeq_epi8(_mm_and_si128(b1, loMask), loPattern));
+
+        int bits = _mm_movemask_epi8(m);
+
+        if(bits != 0) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+
+    return scanSyncWordScalar(buffer, size, i, pattern, mask);
+}
+
+__attribute__((target("avx2")))
+static int scanStartCodePrefixAvx2(const uint8_t* buffer, int size, int offset) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    int i = offset;
+
+    for(; i + 2 + 32 <= size; i += 32) {
+        __m256i b0 = _mm256_loadu_si256((const __m256i*)(buffer + i));
+        __m256i b1 = _mm256_loadu_si256((const __m256i*)(buffer + i + 1));
+        __m256i b2 = _mm256_loadu_si256((const __m256i*)(buffer + i + 2));
+
+        __m256i m = _mm256_and_si256(
+                        _mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+                        _mm256_cmpeq_epi8(b2, one));
+
+        unsigned int bits = (unsigned int)_mm256_movemask_epi8(m);
+
+        if(bits != 0) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+
+    return scanStartCodePrefixSse2(buffer, size, i);
+}
+
+__attribute__((target("avx2")))
+static int scanSyncWordAvx2(const uint8_t* buffer, int size, int offset, uint16_t pattern, uint16_t mask) {
+    const __m256i hiPattern = _mm256_set1_epi8((char)(pattern >> 8));
+    const __m256i hiMask = _mm256_set1_epi8((char)(mask >> 8));
+    const __m256i loPattern = _mm256_set1_epi8((char)(pattern & 0xFF));
+    const __m256i loMask = _mm256_set1_epi8((char)(mask & 0xFF));
+    int i = offset;
+
+    for(; i + 1 + 32 <= size; i += 32) {
+        __m256i b0 = _mm256_loadu_si256((const __m256i*)(buffer + i));
+        __m256i b1 = _mm256_loadu_si256((const __m256i*)(buffer + i + 1));
+
+        __m256i m = _mm256_and_si256(
+                        _mm256_cmpeq_epi8(_mm256_and_si256(b0, hiMask), hiPattern),
+                        _mm256_cmpeq_epi8(_mm256_and_si256(b1, loMask), loPattern));
+
+        unsigned int bits = (unsigned int)_mm256_movemask_epi8(m);
+
+        if(bits != 0) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+
+    return scanSyncWordSse2(buffer, size, i, pattern, mask);
+}
+
+#endif // SCANNER_X86
+
+static StartCodeScanner selectStartCodeScanner() {
+#ifdef SCANNER_X86
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        return scanStartCodePrefixAvx2;
+    }
+
+    if(__builtin_cpu_supports("sse2")) {
+        return scanStartCodePrefixSse2;
+    }
+#endif
+
+    return scanStartCodePrefixScalar;
+}
+
+static SyncWordScanner selectSyncWordScanner() {
+#ifdef SCANNER_X86
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        return scanSyncWordAvx2;
+    }
+
+    if(__builtin_cpu_supports("sse2")) {
+        return scanSyncWordSse2;
+    }
+#endif
+
+    return scanSyncWordScalar;
+}
+
+static const StartCodeScanner startCodeScanner = selectStartCodeScanner();
+
+static const SyncWordScanner syncWordScanner = selectSyncWordScanner();
+
+int scanStartCodePrefix(const uint8_t* buffer, int size, int offset) {
+    if(offset < 0) {
+        offset = 0;
+    }
+
+    return startCodeScanner(buffer, size, offset);
+}
+
+int scanSyncWord(const uint8_t* buffer, int size, int offset, uint16_t pattern, uint16_t mask) {
+    if(offset < 0) {
+        offset = 0;
+    }
+
+    return syncWordScanner(buffer, size, offset, pattern, mask);
+}
@@ -0,0 +1,41 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_DEMUXER_SCANNER_H
+#define ROBOTV_DEMUXER_SCANNER_H
+
+#include <stdint.h>
+
+/**
+ * Bytestream scanners used by the parsers to find start codes and sync words.
+ * The fastest implementation (AVX2 / SSE2 / scalar) is selected at runtime.
+ */
+
+// find the next "00 00 01" start code prefix at or after offset (-1 if not found)
+int scanStartCodePrefix(const uint8_t* buffer, int size, int offset);
+
+// find the next 16 bit big endian word with (word & mask) == pattern at or after offset (-1 if not found)
+int scanSyncWord(const uint8_t* buffer, int size, int offset, uint16_t pattern, uint16_t mask);
+
+#endif // ROBOTV_DEMUXER_SCANNER_H
@@ -0,0 +1,147 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <chrono>
+#include <algorithm>
+
+#include "robotvdmx/pes.h"
+#include "robotvdmx/tsstats.h"
+
+// clock is sampled every 64 packets (and on every PCR)
+#define TSSTATS_CLOCK_MASK 63
+
+#define TSSTATS_WINDOW_NS 1000000000LL
+
+static int64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// distance of two PCR values (27 MHz), handles the wrap around
+static int64_t pcrDiff(int64_t a, int64_t b) {
+    int64_t d = (a - b) % TS_PCR_WRAP;
+
+    if(d < 0) {
+        d += TS_PCR_WRAP;
+    }
+
+    return (d > TS_PCR_WRAP / 2) ? d - TS_PCR_WRAP : d;
+}
+
+void TsMonitor::process(const uint8_t* data) {
+    m_counters.packets++;
+
+    if(TsError(data)) {
+        m_counters.teiErrors++;
+    }
+    else {
+        // the counter only increments on packets with payload (duplicates are allowed)
+        if(TsHasPayload(data)) {
+            int cc = TsContinuityCounter(data);
+
+            if(m_lastCc != -1 && !TsIsDiscontinuity(data) && cc != m_lastCc && cc != ((m_lastCc + 1) & TS_CONT_CNT_MASK)) {
+                m_counters.ccErrors++;
+            }
+
+            m_lastCc = cc;
+        }
+
+        if(TsIsScrambled(data)) {
+            m_counters.scrambled++;
+        }
+    }
+
+    bool pcr = !TsError(data) && TsHasPcr(data);
+
+    if(!pcr && (m_counters.packets & TSSTATS_CLOCK_MASK) != 0) {
+        return;
+    }
+
+    int64_t now = monotonicNs();
+
+    if(pcr) {
+        processPcr(data, now);
+    }
+
+    if(now - m_windowStart >= TSSTATS_WINDOW_NS) {
+        publish(now);
+    }
+}
+
+void TsMonitor::processPcr(const uint8_t* data, int64_t now) {
+    int64_t pcr = TsGetPcr(data);
+    int64_t interval = (m_lastPcr == -1) ? -1 : pcrDiff(pcr, m_lastPcr);
+
+    m_lastPcr = pcr;
+
+    // restart the measurement on discontinuities
+    if(TsIsDiscontinuity(data) || interval < 0 || interval > 27000000) {
+        m_refPcr = -1;
+    }
+    else {
+        m_maxInterval = std::max(m_maxInterval, interval);
+    }
+
+    if(m_refPcr == -1) {
+        m_refPcr = pcr;
+        m_refTime = now;
+    }
+
+    // arrival time relative to the stream clock
+    int64_t offset = (now - m_refTime) - pcrDiff(pcr, m_refPcr) * 1000 / 27;
+
+    if(!m_haveOffset) {
+        m_minOffset = m_maxOffset = offset;
+        m_haveOffset = true;
+        return;
+    }
+
+    m_minOffset = std::min(m_minOffset, offset);
+    m_maxOffset = std::max(m_maxOffset, offset);
+}
+
+void TsMonitor::publish(int64_t now) {
+    int64_t elapsed = now - m_windowStart;
+
+    if(m_windowStart != 0) {
+        m_counters.bitRate = (uint32_t)((m_counters.packets - m_windowPackets) * TS_SIZE * 8 * TSSTATS_WINDOW_NS / elapsed);
+        m_counters.pcrJitter = m_haveOffset ? (uint32_t)((m_maxOffset - m_minOffset) / 1000) : 0;
+        m_counters.pcrInterval = (uint32_t)(m_maxInterval / 27000);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats = m_counters;
+    }
+
+    // next window
+    m_windowStart = now;
+    m_windowPackets = m_counters.packets;
+    m_haveOffset = false;
+    m_maxInterval = 0;
+}
+
+TsStats TsMonitor::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
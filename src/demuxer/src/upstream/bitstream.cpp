@@ -27,12 +27,32 @@
 
 #include "bitstream.h"
 
+int BitStream::rawIndex(void) const {
+    int byte = m_index >> 3;
+    int length = m_length >> 3;
+
+    // the stream only moves forward (or is reset)
+    while(m_byte < byte && m_raw < length) {
+        m_byte++;
+        m_raw++;
+
+        // hit 00 00 03 ?
+        if(m_raw >= 2 && m_raw < length - 1 && m_data[m_raw - 2] == 0 && m_data[m_raw - 1] == 0 && m_data[m_raw] == 3) {
+            m_raw++; // skip 03
+        }
+    }
+
+    return (m_raw << 3) + (m_index & 7) + ((byte - m_byte) << 3);
+}
+
 int BitStream::getBit(void) {
-    if(m_index >= m_length) {
+    int index = m_unescape ? rawIndex() : m_index;
+
+    if(index >= m_length) {
         return 1;
     }
 
-    int r = (m_data[m_index >> 3] >> (7 - (m_index & 7))) & 1;
+    int r = (m_data[index >> 3] >> (7 - (index & 7))) & 1;
     ++m_index;
     return r;
 }
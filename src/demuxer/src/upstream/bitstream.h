@@ -33,7 +33,7 @@
 class BitStream {
 public:
 
-    BitStream(const uint8_t* data, int length) : m_data(data), m_length(length), m_index(0) {
+    BitStream(const uint8_t* data, int length, bool unescape = false) : m_data(data), m_length(length), m_index(0), m_unescape(unescape), m_byte(0), m_raw(0) {
     }
 
     ~BitStream() {}
@@ -57,11 +57,13 @@ public:
     }
 
     bool eof(void) const {
-        return m_index >= m_length;
+        return (m_unescape ? rawIndex() : m_index) >= m_length;
     }
 
     void reset(void) {
         m_index = 0;
+        m_byte = 0;
+        m_raw = 0;
     }
 
     int length(void) const {
@@ -73,14 +75,22 @@ public:
     }
 
     const uint8_t* getData(void) const {
-        return (eof() ? nullptr : m_data + (m_index / 8));
+        return (eof() ? nullptr : m_data + (m_unescape ? rawIndex() : m_index) / 8);
     }
 
 private:
 
+    // bit position in the (escaped) source data
+    int rawIndex(void) const;
+
     const uint8_t* m_data;
     int m_length; // in bits
     int m_index; // in bits
+
+    // skip emulation prevention bytes (00 00 03) of NAL units
+    bool m_unescape;
+    mutable int m_byte; // current byte (unescaped)
+    mutable int m_raw; // current byte (escaped)
 };
 
 #endif // ROBOTV_BITSTREAM_H
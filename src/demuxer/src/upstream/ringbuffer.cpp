@@ -26,26 +26,65 @@
  */
 
 #include "ringbuffer.h"
+#include "parsers/chunkpool.h"
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 
-RingBuffer::RingBuffer(int size, int margin) {
+#include <algorithm>
+
+// del() calls with low fill level before a grown buffer shrinks
+#define RINGBUFFER_IDLE_COUNT 256
+
+RingBuffer::RingBuffer(int size, int margin, int maxSize) {
     m_size = size;
     m_tail = m_head = m_margin = margin;
     m_gotten = 0;
     m_buffer = NULL;
+    m_capacity = 0;
+    m_minSize = size;
+    m_maxSize = std::max(size, maxSize);
+    m_idle = 0;
 
     if(size > 1) {  // 'Size - 1' must not be 0!
         if(margin <= size / 2) {
-            m_buffer = (uint8_t*)malloc((size_t)size);
+            m_buffer = ChunkPool::instance().acquire(size, m_capacity);
             clear();
         }
     }
 }
 
 RingBuffer::~RingBuffer() {
-    ::free(m_buffer);
+    if(m_buffer != NULL) {
+        ChunkPool::instance().release(m_buffer, m_capacity);
+    }
+}
+
+void RingBuffer::resize(int size) {
+    int capacity = 0;
+    uint8_t* buffer = ChunkPool::instance().acquire(size, capacity);
+
+    // move the data to the start of the new buffer
+    int count = available();
+
+    if(m_head >= m_tail) {
+        memcpy(buffer + m_margin, m_buffer + m_tail, (size_t)count);
+    }
+    else {
+        int rest = m_size - m_tail;
+        memcpy(buffer + m_margin, m_buffer + m_tail, (size_t)rest);
+        memcpy(buffer + m_margin + rest, m_buffer + m_margin, (size_t)(count - rest));
+    }
+
+    ChunkPool::instance().release(m_buffer, m_capacity);
+
+    m_buffer = buffer;
+    m_capacity = capacity;
+    m_size = size;
+    m_tail = m_margin;
+    m_head = m_margin + count;
+    m_gotten = 0;
+    m_idle = 0;
 }
 
 int RingBuffer::onDataReady(const uint8_t* data, int count) {
@@ -66,6 +105,17 @@ int RingBuffer::put(const uint8_t *data, int count) {
         return count;
     }
 
+    // grow on demand
+    if(m_buffer != NULL && count > free() && m_size < m_maxSize) {
+        int size = m_size;
+
+        while(size < m_maxSize && size - available() - 1 - m_margin < count) {
+            size *= 2;
+        }
+
+        resize(std::min(size, m_maxSize));
+    }
+
     int Tail = m_tail;
     int rest = size() - m_head;
     int diff = Tail - m_head;
@@ -143,4 +193,13 @@ void RingBuffer::del(int count) {
     }
 
     m_tail = tail;
+
+    // shrink a grown buffer if it has been idle for a while
+    if(m_size > m_minSize) {
+        m_idle = (available() < m_minSize / 4) ? m_idle + 1 : 0;
+
+        if(m_idle >= RINGBUFFER_IDLE_COUNT) {
+            resize(m_minSize);
+        }
+    }
 }
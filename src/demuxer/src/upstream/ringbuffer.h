@@ -40,6 +40,13 @@ private:
     int m_gotten;
     uint8_t* m_buffer;
 
+    int m_capacity;
+    int m_minSize;
+    int m_maxSize;
+    int m_idle;
+
+    void resize(int size);
+
 protected:
     int size(void) const {
         return m_size;
@@ -63,11 +70,14 @@ public:
      * Creates a linear ring buffer.
      * The buffer will be able to hold at most size-margin-1 bytes of data, and will
      * be guaranteed to return at least margin bytes in one consecutive block.
+     * If maxSize is larger than size, the buffer grows on demand up to maxSize
+     * and shrinks back to size once it has been idle for a while.
      *
      * @param size total size of the buffer
      * @param margin block size
+     * @param maxSize size limit of a growing buffer
      */
-    RingBuffer(int size, int margin = 0);
+    RingBuffer(int size, int margin = 0, int maxSize = 0);
 
     virtual ~RingBuffer();
 
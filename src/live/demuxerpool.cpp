@@ -0,0 +1,482 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <sched.h>
+
+#include <vdr/tools.h>
+
+#include "robotvdmx/pes.h"
+#include "demuxerpool.h"
+
+// minimum batch size (TS packets)
+#define POOL_MIN_BATCH 64
+
+// maximum time packets are queued before the batch is dispatched
+#define POOL_MAX_DELAY std::chrono::milliseconds(10)
+
+// maximum number of queued packets while a batch is running (or the
+// demuxers are suspended), further packets are dropped
+#define POOL_MAX_QUEUED 8192
+
+// interval of the timer checking for delayed batches
+#define POOL_TIMER_INTERVAL std::chrono::milliseconds(5)
+
+// current task of a worker thread
+static thread_local DemuxerPool::Task* currentTask = nullptr;
+
+static thread_local int currentIndex = 0;
+
+int DemuxerPool::m_threads = 0;
+
+DemuxerPool::Worker::Worker() : m_head(&m_stub), m_tail(&m_stub) {
+    m_stub.next = nullptr;
+    sem_init(&semaphore, 0, 0);
+}
+
+DemuxerPool::Worker::~Worker() {
+    sem_destroy(&semaphore);
+}
+
+void DemuxerPool::Worker::push(Task* task) {
+    task->next.store(nullptr, std::memory_order_relaxed);
+    Task* prev = m_head.exchange(task, std::memory_order_acq_rel);
+    prev->next.store(task, std::memory_order_release);
+}
+
+DemuxerPool::Task* DemuxerPool::Worker::pop() {
+    Task* tail = m_tail;
+    Task* next = tail->next.load(std::memory_order_acquire);
+
+    if(tail == &m_stub) {
+        if(next == nullptr) {
+            return nullptr;
+        }
+
+        m_tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if(next != nullptr) {
+        m_tail = next;
+        return tail;
+    }
+
+    // a producer is in the middle of a push
+    if(tail != m_head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+
+    push(&m_stub);
+    next = tail->next.load(std::memory_order_acquire);
+
+    if(next != nullptr) {
+        m_tail = next;
+        return tail;
+    }
+
+    return nullptr;
+}
+
+void DemuxerPool::Worker::run() {
+    for(;;) {
+        sem_wait(&semaphore);
+
+        if(!running) {
+            break;
+        }
+
+        // the semaphore guarantees a task, wait for the push to complete
+        Task* task = nullptr;
+
+        while((task = pop()) == nullptr) {
+            sched_yield();
+        }
+
+        DemuxerPool::execute(task);
+    }
+}
+
+DemuxerPool::DemuxerPool() {
+    for(int i = 0; i < m_threads; i++) {
+        Worker* worker = new Worker;
+        worker->thread = new std::thread([worker]() {
+            worker->run();
+        });
+
+        m_workers.push_back(worker);
+    }
+
+    if(m_threads > 0) {
+        m_timer = new std::thread([this]() {
+            timer();
+        });
+
+        isyslog("demuxer pool started with %i threads", m_threads);
+    }
+}
+
+DemuxerPool::~DemuxerPool() {
+    stop();
+}
+
+DemuxerPool& DemuxerPool::instance() {
+    static DemuxerPool pool;
+    return pool;
+}
+
+void DemuxerPool::setThreads(int threads) {
+    m_threads = std::max(0, threads);
+    isyslog("demuxer threads: %i", m_threads);
+}
+
+void DemuxerPool::submit(int worker, Task* task) {
+    Worker* w = m_workers[worker];
+    w->push(task);
+    sem_post(&w->semaphore);
+}
+
+void DemuxerPool::stop() {
+    if(m_timer != nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_timerRunning = false;
+        }
+
+        m_condition.notify_one();
+        m_timer->join();
+
+        delete m_timer;
+        m_timer = nullptr;
+    }
+
+    for(auto w : m_workers) {
+        w->running = false;
+        sem_post(&w->semaphore);
+        w->thread->join();
+
+        delete w->thread;
+        delete w;
+    }
+
+    m_workers.clear();
+}
+
+void DemuxerPool::execute(Task* task) {
+    task->owner->demux(task);
+}
+
+void DemuxerPool::add(PooledDemuxer* demuxer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_demuxers.insert(demuxer);
+}
+
+void DemuxerPool::remove(PooledDemuxer* demuxer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_demuxers.erase(demuxer);
+}
+
+void DemuxerPool::timer() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(m_timerRunning) {
+        m_condition.wait_for(lock, POOL_TIMER_INTERVAL);
+
+        // the lock keeps demuxers from being removed while we flush them
+        auto now = std::chrono::steady_clock::now();
+
+        for(auto demuxer : m_demuxers) {
+            demuxer->flush(now);
+        }
+    }
+}
+
+PooledDemuxer::PooledDemuxer(DemuxerBundle* demuxers, TsDemuxer::Listener* listener, uint32_t uid)
+    : m_demuxers(demuxers)
+    , m_listener(listener)
+    , m_uid(uid)
+    , m_inFlight(false)
+    , m_pending(0) {
+
+    int size = DemuxerPool::instance().size();
+
+    for(int i = 0; i < size; i++) {
+        m_queued.push_back(new Part);
+        m_queued.back()->owner = this;
+
+        m_running.push_back(new Part);
+        m_running.back()->owner = this;
+    }
+
+    if(size > 0) {
+        DemuxerPool::instance().add(this);
+    }
+}
+
+PooledDemuxer::~PooledDemuxer() {
+    DemuxerPool::instance().remove(this);
+    drain();
+
+    if(m_overflows > 0) {
+        esyslog("demuxer pool: %lu TS packets lost (queue overflow)", (unsigned long)m_overflows);
+    }
+
+    for(auto p : m_queued) {
+        delete p;
+    }
+
+    for(auto p : m_running) {
+        delete p;
+    }
+}
+
+void PooledDemuxer::process(uint8_t* data, int length) {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    int size = (int)m_queued.size();
+
+    if(size == 0) {
+        lock.unlock();
+        m_demuxers->processTsPackets(data, length);
+        return;
+    }
+
+    // workers can't keep up - never block the receiver thread, the device
+    // would overflow for all of its receivers
+    if(m_queuedPackets >= POOL_MAX_QUEUED) {
+        m_overflows += length / TS_SIZE;
+        return;
+    }
+
+    if(m_queuedPackets == 0) {
+        m_queueStart = std::chrono::steady_clock::now();
+    }
+
+    // shard packets by pid
+    for(; length >= TS_SIZE; data += TS_SIZE, length -= TS_SIZE) {
+        if(*data != TS_SYNC_BYTE) {
+            continue;
+        }
+
+        Part* part = m_queued[(TsPid(data) + m_uid) % size];
+        part->packets.insert(part->packets.end(), data, data + TS_SIZE);
+        part->indices.push_back(m_queuedPackets++);
+    }
+
+    // previous batch still running, the queue is dispatched when it's done
+    if(!m_inFlight.load(std::memory_order_acquire) && due(std::chrono::steady_clock::now())) {
+        dispatch();
+    }
+}
+
+void PooledDemuxer::flush(std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+
+    if(!m_inFlight.load(std::memory_order_acquire) && due(now)) {
+        dispatch();
+    }
+}
+
+bool PooledDemuxer::due(std::chrono::steady_clock::time_point now) {
+    if(m_suspended > 0) {
+        return false;
+    }
+
+    return m_queuedPackets >= POOL_MIN_BATCH || (m_queuedPackets > 0 && now - m_queueStart >= POOL_MAX_DELAY);
+}
+
+void PooledDemuxer::suspend() {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    m_suspended++;
+
+    // wait for the running batch
+    while(m_inFlight.load(std::memory_order_acquire)) {
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        lock.lock();
+    }
+}
+
+void PooledDemuxer::resume() {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_suspended--;
+
+    if(!m_inFlight.load(std::memory_order_acquire) && due(std::chrono::steady_clock::now())) {
+        dispatch();
+    }
+}
+
+// must be called with the queue locked and no batch in flight
+void PooledDemuxer::dispatch() {
+    int count = 0;
+
+    for(auto p : m_queued) {
+        if(!p->packets.empty()) {
+            count++;
+        }
+    }
+
+    if(count == 0) {
+        return;
+    }
+
+    m_queued.swap(m_running);
+    m_queuedPackets = 0;
+
+    m_pending.store(count, std::memory_order_relaxed);
+    m_inFlight.store(true, std::memory_order_release);
+
+    for(size_t i = 0; i < m_running.size(); i++) {
+        if(!m_running[i]->packets.empty()) {
+            DemuxerPool::instance().submit(i, m_running[i]);
+        }
+    }
+}
+
+void PooledDemuxer::drain() {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+
+    // drop the queue first, so the running batch doesn't dispatch it
+    for(auto p : m_queued) {
+        p->packets.clear();
+        p->indices.clear();
+    }
+
+    m_queuedPackets = 0;
+
+    // wait for the running batch, the worker finishes it under the queue lock
+    while(m_inFlight.load(std::memory_order_acquire)) {
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        lock.lock();
+    }
+}
+
+void PooledDemuxer::demux(DemuxerPool::Task* task) {
+    Part* part = static_cast<Part*>(task);
+    currentTask = task;
+
+    for(size_t i = 0; i < part->indices.size(); i++) {
+        currentIndex = part->indices[i];
+        m_demuxers->processTsPacket(&part->packets[i * TS_SIZE]);
+    }
+
+    currentTask = nullptr;
+
+    // the last worker delivers the batch
+    if(m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        deliver();
+    }
+}
+
+void PooledDemuxer::deliver() {
+    std::vector<size_t> positions(m_running.size(), 0);
+
+    // merge the events of all workers in TS packet order
+    for(;;) {
+        Part* next = nullptr;
+        size_t n = 0;
+
+        for(size_t i = 0; i < m_running.size(); i++) {
+            Part* p = m_running[i];
+
+            if(positions[i] < p->events.size() && (next == nullptr || p->events[positions[i]].index < next->events[positions[n]].index)) {
+                next = p;
+                n = i;
+            }
+        }
+
+        if(next == nullptr) {
+            break;
+        }
+
+        Event& e = next->events[positions[n]++];
+
+        if(e.streamChange) {
+            m_listener->onStreamChange();
+        }
+        else {
+            // copied payloads are relocated with the data vector
+            if(e.packet.buffer == nullptr) {
+                e.packet.data = next->data.data() + e.offset;
+            }
+
+            m_listener->onStreamPacket(&e.packet);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+
+    for(auto p : m_running) {
+        p->packets.clear();
+        p->indices.clear();
+        p->events.clear();
+        p->data.clear();
+    }
+
+    m_inFlight.store(false, std::memory_order_release);
+
+    // dispatch the packets queued meanwhile
+    if(due(std::chrono::steady_clock::now())) {
+        dispatch();
+    }
+}
+
+void PooledDemuxer::onStreamPacket(TsDemuxer::StreamPacket* pkt) {
+    Part* part = static_cast<Part*>(currentTask);
+
+    if(part == nullptr) {
+        m_listener->onStreamPacket(pkt);
+        return;
+    }
+
+    Event e;
+    e.index = currentIndex;
+    e.streamChange = false;
+    e.packet = *pkt;
+    e.offset = part->data.size();
+
+    // keep assembled PES packets, only copy payloads the parser reuses
+    if(pkt->buffer == nullptr && pkt->data != nullptr && pkt->size > 0) {
+        part->data.insert(part->data.end(), pkt->data, pkt->data + pkt->size);
+    }
+
+    part->events.push_back(e);
+}
+
+void PooledDemuxer::onStreamChange() {
+    Part* part = static_cast<Part*>(currentTask);
+
+    if(part == nullptr) {
+        m_listener->onStreamChange();
+        return;
+    }
+
+    Event e;
+    e.index = currentIndex;
+    e.streamChange = true;
+    e.offset = 0;
+
+    part->events.push_back(e);
+}
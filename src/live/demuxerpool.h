@@ -0,0 +1,236 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifndef ROBOTV_DEMUXERPOOL_H
+#define ROBOTV_DEMUXERPOOL_H
+
+#include <semaphore.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "robotvdmx/demuxer.h"
+#include "robotvdmx/demuxerbundle.h"
+
+class PooledDemuxer;
+
+/**
+ * Worker pool for demuxing.
+ *
+ * TS packets of a channel are sharded by PID across the workers, so every
+ * TsDemuxer is always driven by the same thread. Batches are handed over
+ * through lock-free (intrusive MPSC) queues. A timer thread dispatches
+ * queued packets that have been waiting for too long.
+ */
+
+class DemuxerPool {
+public:
+
+    // a batch of TS packets for one worker
+    struct Task {
+        std::atomic<Task*> next;
+        PooledDemuxer* owner = nullptr;
+        std::vector<uint8_t> packets;
+        std::vector<int> indices;
+    };
+
+    ~DemuxerPool();
+
+    static DemuxerPool& instance();
+
+    static void setThreads(int threads);
+
+    bool enabled() const {
+        return !m_workers.empty();
+    }
+
+    int size() const {
+        return (int)m_workers.size();
+    }
+
+    void submit(int worker, Task* task);
+
+    void stop();
+
+    void add(PooledDemuxer* demuxer);
+
+    void remove(PooledDemuxer* demuxer);
+
+protected:
+
+    DemuxerPool();
+
+private:
+
+    class Worker {
+    public:
+
+        Worker();
+
+        ~Worker();
+
+        void push(Task* task);
+
+        Task* pop();
+
+        void run();
+
+        std::thread* thread = nullptr;
+
+        sem_t semaphore;
+
+        bool running = true;
+
+    private:
+
+        std::atomic<Task*> m_head;
+
+        Task* m_tail;
+
+        Task m_stub;
+
+    };
+
+    static void execute(Task* task);
+
+    void timer();
+
+    std::vector<Worker*> m_workers;
+
+    std::thread* m_timer = nullptr;
+
+    bool m_timerRunning = true;
+
+    // demuxers checked by the timer
+    std::set<PooledDemuxer*> m_demuxers;
+
+    std::mutex m_mutex;
+
+    std::condition_variable m_condition;
+
+    static int m_threads;
+
+};
+
+/**
+ * Demuxes the TS packets of a DemuxerBundle on the DemuxerPool.
+ *
+ * Packets are collected in batches. Only one batch per channel is in flight,
+ * the stream packets produced by the workers are delivered to the listener
+ * in the order of the TS packets they originate from. This keeps the
+ * audio / video interleaving identical to serial demuxing.
+ */
+
+class PooledDemuxer : public TsDemuxer::Listener {
+public:
+
+    PooledDemuxer(DemuxerBundle* demuxers, TsDemuxer::Listener* listener, uint32_t uid);
+
+    virtual ~PooledDemuxer();
+
+    // queue TS packets (receiver thread)
+    void process(uint8_t* data, int length);
+
+    // wait for the running batch and drop all queued packets
+    void drain();
+
+    // dispatch packets queued for longer than the maximum delay (timer thread)
+    void flush(std::chrono::steady_clock::time_point now);
+
+    // keep the workers off the demuxers, packets are queued meanwhile
+    void suspend();
+
+    void resume();
+
+    // TsDemuxer::Listener implementation (worker threads)
+
+    void onStreamPacket(TsDemuxer::StreamPacket* pkt);
+
+    void onStreamChange();
+
+private:
+
+    // an emitted stream packet or stream change
+    struct Event {
+        int index;
+        bool streamChange;
+        TsDemuxer::StreamPacket packet;
+        size_t offset;
+    };
+
+    struct Part : public DemuxerPool::Task {
+        std::vector<Event> events;
+        // payloads without a buffer owner (audio frames, linearised packets)
+        std::vector<uint8_t> data;
+    };
+
+    bool due(std::chrono::steady_clock::time_point now);
+
+    void dispatch();
+
+    void demux(DemuxerPool::Task* task);
+
+    void deliver();
+
+    friend class DemuxerPool;
+
+    DemuxerBundle* m_demuxers;
+
+    TsDemuxer::Listener* m_listener;
+
+    uint32_t m_uid;
+
+    // queued packets / running batch (per worker)
+    // the queue is filled by the receiver and dispatched by the receiver,
+    // the worker delivering the previous batch or the timer
+    std::vector<Part*> m_queued;
+
+    std::vector<Part*> m_running;
+
+    int m_queuedPackets = 0;
+
+    std::chrono::steady_clock::time_point m_queueStart;
+
+    std::mutex m_queueMutex;
+
+    // number of threads accessing the demuxers
+    int m_suspended = 0;
+
+    // TS packets dropped on queue overflow
+    uint64_t m_overflows = 0;
+
+    std::atomic<bool> m_inFlight;
+
+    std::atomic<int> m_pending;
+
+};
+
+#endif // ROBOTV_DEMUXERPOOL_H
@@ -0,0 +1,96 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "keyframeindex.h"
+#include <algorithm>
+
+void KeyFrameIndex::add(off_t filePosition, std::chrono::milliseconds wallclockTime, int64_t pts, int wrapCount) {
+    m_entries.push_back({filePosition, wallclockTime, pts, wrapCount});
+}
+
+void KeyFrameIndex::trim(off_t position, int wrapCount) {
+    while(!m_entries.empty()) {
+        const Entry& e = m_entries.front();
+
+        if(e.wrapCount >= wrapCount || (e.wrapCount == wrapCount - 1 && e.filePosition >= position)) {
+            break;
+        }
+
+        m_entries.pop_front();
+    }
+}
+
+void KeyFrameIndex::trimBefore(off_t position, int wrapCount) {
+    while(!m_entries.empty()) {
+        const Entry& e = m_entries.front();
+
+        if(e.wrapCount > wrapCount || (e.wrapCount == wrapCount && e.filePosition >= position)) {
+            break;
+        }
+
+        m_entries.pop_front();
+    }
+}
+
+void KeyFrameIndex::clear() {
+    m_entries.clear();
+}
+
+bool KeyFrameIndex::empty() const {
+    return m_entries.empty();
+}
+
+size_t KeyFrameIndex::size() const {
+    return m_entries.size();
+}
+
+const KeyFrameIndex::Entry& KeyFrameIndex::front() const {
+    return m_entries.front();
+}
+
+const KeyFrameIndex::Entry& KeyFrameIndex::back() const {
+    return m_entries.back();
+}
+
+KeyFrameIndex::const_iterator KeyFrameIndex::end() const {
+    return m_entries.end();
+}
+
+KeyFrameIndex::const_iterator KeyFrameIndex::findByTime(int64_t wallclockTimeMs) const {
+    if(m_entries.empty()) {
+        return m_entries.end();
+    }
+
+    auto i = std::upper_bound(m_entries.begin(), m_entries.end(), wallclockTimeMs, [](int64_t t, const Entry& e) {
+        return t < e.wallclockTime.count();
+    });
+
+    return (i == m_entries.begin()) ? i : i - 1;
+}
+
+KeyFrameIndex::const_iterator KeyFrameIndex::findByPosition(off_t filePosition, int wrapCount) const {
+    return std::lower_bound(m_entries.begin(), m_entries.end(), Entry{filePosition, std::chrono::milliseconds(0), 0, wrapCount}, [](const Entry& a, const Entry& b) {
+        return (a.wrapCount < b.wrapCount) || (a.wrapCount == b.wrapCount && a.filePosition < b.filePosition);
+    });
+}
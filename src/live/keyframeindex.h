@@ -0,0 +1,85 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_KEYFRAMEINDEX_H
+#define ROBOTV_KEYFRAMEINDEX_H
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+
+/**
+ * Keyframe index of the timeshift ringbuffer.
+ *
+ * Entries are appended in write order, so they are sorted by
+ * (wrapCount, filePosition) and by wallclock time. All lookups are
+ * binary searches, trimming only ever removes entries from the front.
+ */
+
+class KeyFrameIndex {
+public:
+
+    struct Entry {
+        off_t filePosition;
+        std::chrono::milliseconds wallclockTime;
+        int64_t pts;
+        int wrapCount;
+    };
+
+    typedef std::deque<Entry>::const_iterator const_iterator;
+
+    void add(off_t filePosition, std::chrono::milliseconds wallclockTime, int64_t pts, int wrapCount);
+
+    // remove all entries of previous buffer laps located before 'position'
+    void trim(off_t position, int wrapCount);
+
+    // remove all entries located before 'position' of the given buffer lap
+    void trimBefore(off_t position, int wrapCount);
+
+    void clear();
+
+    bool empty() const;
+
+    size_t size() const;
+
+    const Entry& front() const;
+
+    const Entry& back() const;
+
+    const_iterator end() const;
+
+    // last keyframe at or before the wallclock time (clamped to the buffer)
+    const_iterator findByTime(int64_t wallclockTimeMs) const;
+
+    // first keyframe at or after the file position in the given buffer lap
+    const_iterator findByPosition(off_t filePosition, int wrapCount) const;
+
+private:
+
+    std::deque<Entry> m_entries;
+
+};
+
+#endif // ROBOTV_KEYFRAMEINDEX_H
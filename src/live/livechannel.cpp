@@ -0,0 +1,625 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <vdr/remux.h>
+#include <vdr/timers.h>
+
+#include "net/msgpacket.h"
+#include "robotv/robotvcommand.h"
+#include "tools/hash.h"
+#include "tools/time.h"
+
+#include "livechannel.h"
+#include "livestreamer.h"
+#include "livequeue.h"
+#include "channelcache.h"
+#include "demuxerpool.h"
+
+std::map<uint32_t, LiveChannel*> LiveChannel::m_channels;
+std::mutex LiveChannel::m_channelsMutex;
+int LiveChannel::m_idCnt = 0;
+
+LiveChannel::LiveChannel(const cChannel* channel, int priority, bool cache)
+    : cReceiver(nullptr, priority)
+    , m_demuxers(this)
+    , m_cacheEnabled(cache) {
+    m_uid = createChannelUid(channel);
+
+    // create timeshift queue
+    m_queue = new LiveQueue(m_idCnt++);
+
+    // demux on the worker pool
+    if(DemuxerPool::instance().enabled()) {
+        m_pool = new PooledDemuxer(&m_demuxers, this, m_uid);
+        m_demuxers.setListener(m_pool);
+    }
+}
+
+LiveChannel::~LiveChannel() {
+    cDevice * device = Device();
+
+    if(device != nullptr) {
+        cCamSlot *camSlot = device->CamSlot();
+
+        if (camSlot != nullptr) {
+            isyslog("camslot detached");
+            ChannelCamRelations.ClrChecked(ChannelID(), camSlot->SlotNumber());
+        }
+
+        Detach();
+    }
+
+    delete m_pool;
+    logOverflows();
+    m_demuxers.clear();
+    delete m_queue;
+
+    isyslog("live channel %08x terminated", m_uid);
+}
+
+LiveChannel* LiveChannel::attach(LiveStreamer* streamer, const cChannel* channel, int priority, bool cache, int& status) {
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+
+    uint32_t uid = createChannelUid(channel);
+    LiveChannel* live = nullptr;
+
+    auto i = m_channels.find(uid);
+
+    // channel is already streamed to other clients
+    if(i != m_channels.end()) {
+        live = i->second;
+        isyslog("attaching to running live channel %i - %s", channel->Number(), channel->Name());
+
+        // retune if we lost the device (with the priority of the requesting client)
+        if(!live->IsAttached()) {
+            status = live->switchChannel(channel, std::max(priority, live->Priority()));
+
+            if(status != ROBOTV_RET_OK) {
+                return nullptr;
+            }
+        }
+
+        if(priority > live->Priority()) {
+            live->SetPriority(priority);
+        }
+    }
+    // start a new live channel
+    else {
+        live = new LiveChannel(channel, priority, cache);
+        status = live->switchChannel(channel);
+
+        if(status != ROBOTV_RET_OK) {
+            delete live;
+            return nullptr;
+        }
+
+        m_channels[uid] = live;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(live->m_mutex);
+        live->m_streamers.push_back(streamer);
+    }
+
+    status = ROBOTV_RET_OK;
+    return live;
+}
+
+void LiveChannel::detach(LiveStreamer* streamer, LiveChannel* channel) {
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(channel->m_mutex);
+        channel->m_streamers.remove(streamer);
+
+        if(!channel->m_streamers.empty()) {
+            return;
+        }
+    }
+
+    // last client gone - keep standby channels running (but let them yield
+    // to everybody else)
+    if(channel->m_standby) {
+        channel->SetPriority(MINPRIORITY);
+        return;
+    }
+
+    m_channels.erase(channel->m_uid);
+    delete channel;
+}
+
+bool LiveChannel::addStandby(const cChannel* channel, bool cache) {
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+
+    uint32_t uid = createChannelUid(channel);
+    auto i = m_channels.find(uid);
+
+    if(i != m_channels.end()) {
+        i->second->m_standby = true;
+        return true;
+    }
+
+    // only use idle devices (or devices already tuned to the transponder)
+    LiveChannel* live = new LiveChannel(channel, MINPRIORITY, cache);
+
+    if(live->switchChannel(channel, MINPRIORITY) != ROBOTV_RET_OK) {
+        delete live;
+        return false;
+    }
+
+    isyslog("standby receiver for channel %i - %s started", channel->Number(), channel->Name());
+
+    live->m_standby = true;
+    m_channels[uid] = live;
+
+    return true;
+}
+
+void LiveChannel::removeStandby(uint32_t uid) {
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+
+    auto i = m_channels.find(uid);
+
+    if(i == m_channels.end()) {
+        return;
+    }
+
+    LiveChannel* live = i->second;
+    live->m_standby = false;
+
+    {
+        std::lock_guard<std::mutex> lock(live->m_mutex);
+
+        if(!live->m_streamers.empty()) {
+            return;
+        }
+    }
+
+    m_channels.erase(i);
+    delete live;
+}
+
+bool LiveChannel::isReceiving(uint32_t uid) {
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+
+    auto i = m_channels.find(uid);
+    return (i != m_channels.end() && i->second->IsAttached());
+}
+
+void LiveChannel::onStreamChange() {
+    m_requestStreamChange = true;
+}
+
+int LiveChannel::switchChannel(const cChannel* channel, int priority) {
+    if(channel == nullptr) {
+        esyslog("unknown channel !");
+        return ROBOTV_RET_ERROR;
+    }
+
+    // get device for this channel
+    cDevice* device = cDevice::GetDevice(channel, priority, false);
+
+    // maybe an encrypted channel that cannot be handled
+    // lets try if a device can decrypt it on it's own (without a CAM slot)
+    if(device == nullptr) {
+        device = cDevice::GetDeviceForTransponder(channel, priority);
+    }
+
+    // maybe all devices busy
+    if(device == nullptr) {
+        // return status "recording running" if there is an active timer
+        time_t now = time(nullptr);
+
+        for(cTimer* ti = Timers.First(); ti; ti = Timers.Next(ti)) {
+            if(ti->Recording() && ti->Matches(now)) {
+                esyslog("Recording running !");
+                return ROBOTV_RET_RECRUNNING;
+            }
+        }
+
+        esyslog("No device available !");
+        return ROBOTV_RET_DATALOCKED;
+    }
+
+    isyslog("Found available device %d", device->DeviceNumber() + 1);
+
+    if(!device->SwitchChannel(channel, false)) {
+        esyslog("Can't switch to channel %i - %s", channel->Number(), channel->Name());
+        return ROBOTV_RET_ERROR;
+    }
+
+    m_uid = createChannelUid(channel);
+
+    StreamBundle currentitem = createFromChannel(channel);
+    StreamBundle bundle;
+
+    // get cached demuxer data (if available & enabled)
+    if(m_cacheEnabled) {
+        ChannelCache &cache = ChannelCache::instance();
+        bundle = cache.lookup(m_uid);
+
+        // channel already in cache
+        if (bundle.size() != 0) {
+            isyslog("Channel information found in cache");
+        }
+        // channel not found in cache -> add it from vdr
+        else {
+            isyslog("adding channel to cache");
+            bundle = createFromChannel(channel);
+            cache.add(m_uid, bundle);
+        }
+
+        // recheck cache item
+        if (!currentitem.isMetaOf(bundle)) {
+            isyslog("current channel differs from cache item - updating");
+            bundle = createFromChannel(channel);
+            cache.add(m_uid, bundle);
+        }
+    }
+    // use current channel data
+    else {
+        bundle = currentitem;
+    }
+
+    if(bundle.size() == 0) {
+        esyslog("channel %i - %s doesn't have any stream information", channel->Number(), channel->Name());
+        return ROBOTV_RET_ERROR;
+    }
+
+    isyslog("Creating demuxers");
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_channelBundle = currentitem;
+        createDemuxers(&bundle);
+    }
+
+    onStreamChange();
+
+    isyslog("Successfully switched to channel %i - %s", channel->Number(), channel->Name());
+
+    // fool device to not start the decryption timer
+    int receiverPriority = Priority();
+    SetPriority(MINPRIORITY);
+
+    /// attach receiver
+    if (device->AttachReceiver(this) == false) {
+        esyslog("failed to attach receiver !");
+        return ROBOTV_RET_ERROR;
+    }
+
+    // start decrypting manually
+    cCamSlot* slot = device->CamSlot();
+
+    if(slot) {
+        slot->StartDecrypting();
+    }
+
+    SetPriority(receiverPriority);
+
+    isyslog("done switching.");
+    return ROBOTV_RET_OK;
+}
+
+void LiveChannel::onStreamPacket(TsDemuxer::StreamPacket *pkt) {
+    // skip empty packets
+    if(pkt == nullptr || pkt->size == 0) {
+        return;
+    }
+
+    // skip non audio / video packets
+    if(!(pkt->content == StreamInfo::Content::AUDIO || pkt->content == StreamInfo::Content::VIDEO)) {
+        return;
+    }
+
+    // send stream change on demand
+    if(m_requestStreamChange && m_demuxers.isReady()) {
+        sendStreamChange();
+    }
+
+    // initialise stream packet
+    MsgPacket* packet = new MsgPacket(ROBOTV_STREAM_MUXPKT, ROBOTV_CHANNEL_STREAM);
+    packet->disablePayloadCheckSum();
+
+    // write stream data
+    packet->put_U16(pkt->pid);
+    packet->put_S64(pkt->pts);
+    packet->put_S64(pkt->dts);
+    packet->put_U32(pkt->duration);
+
+    // write frame type into unused header field clientid
+    packet->setClientID((uint16_t)pkt->frameType);
+
+    // write payload into stream packet
+    packet->put_U32(pkt->size);
+    packet->put_Blob(pkt->data, pkt->size);
+
+    // add timestamp (wallclock time in ms)
+    packet->put_S64(roboTV::currentTimeMillis().count());
+
+    m_queue->queue(packet, pkt->content, pkt->pts);
+}
+
+void LiveChannel::sendStreamChange() {
+    isyslog("stream change notification");
+
+    StreamBundle cache;
+
+    for(auto i = m_demuxers.begin(); i != m_demuxers.end(); i++) {
+        cache.addStream(*(*i));
+    }
+
+    ChannelCache::instance().add(m_uid, cache);
+
+    // the stream order is client specific,
+    // each client replaces this packet with its preferred order
+    MsgPacket* resp = LiveStreamer::createStreamChangePacket(m_demuxers);
+    m_queue->queue(resp, StreamInfo::Content::STREAMINFO);
+
+    m_requestStreamChange = false;
+}
+
+MsgPacket* LiveChannel::createStreamChangePacket(const char* lang, StreamInfo::Type type) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    suspendDemuxers();
+
+    MsgPacket* p = LiveStreamer::createStreamChangePacket(m_demuxers.sortedStreams(lang, type));
+
+    resumeDemuxers();
+    return p;
+}
+
+MsgPacket* LiveChannel::createSignalInfoPacket(bool streamStats) {
+    cDevice* device = Device();
+
+    if(device == nullptr || !IsAttached()) {
+        return nullptr;
+    }
+
+    MsgPacket* resp = new MsgPacket(ROBOTV_STREAM_SIGNALINFO, ROBOTV_CHANNEL_STREAM);
+
+    int DeviceNumber = device->DeviceNumber() + 1;
+    int Strength = 0;
+    int Quality = 0;
+
+    Strength = device->SignalStrength();
+    Quality = device->SignalQuality();
+
+    resp->put_String(*cString::sprintf(
+                         "%s #%d - %s",
+                         (const char*)device->DeviceType(),
+                         DeviceNumber,
+                         (const char*)device->DeviceName()));
+
+    // Quality:
+    // 4 - NO LOCK
+    // 3 - NO SYNC
+    // 2 - NO VITERBI
+    // 1 - NO CARRIER
+    // 0 - NO SIGNAL
+
+    if(Quality == -1) {
+        resp->put_String("UNKNOWN (Incompatible device)");
+        Quality = 0;
+    }
+    else {
+        resp->put_String(*cString::sprintf("%s:%s:%s:%s:%s",
+                                           (Quality > 4) ? "LOCKED" : "-",
+                                           (Quality > 0) ? "SIGNAL" : "-",
+                                           (Quality > 1) ? "CARRIER" : "-",
+                                           (Quality > 2) ? "VITERBI" : "-",
+                                           (Quality > 3) ? "SYNC" : "-"));
+    }
+
+    resp->put_U32((Strength << 16) / 100);
+    resp->put_U32((Quality << 16) / 100);
+    resp->put_U32(0);
+    resp->put_U32(0);
+
+    // get provider & service information
+    const cChannel* channel = findChannelByUid(m_uid);
+
+    if(channel != nullptr) {
+        // put in provider name
+        resp->put_String(channel->Provider());
+
+        // what the heck should be the service name ?
+        // using PortalName for now
+        resp->put_String(channel->PortalName());
+    }
+    else {
+        resp->put_String("");
+        resp->put_String("");
+    }
+
+    if(streamStats) {
+        putStreamStats(resp);
+    }
+
+    return resp;
+}
+
+void LiveChannel::putStreamStats(MsgPacket* p) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    suspendDemuxers();
+
+    p->put_U32((uint32_t)m_demuxers.size());
+
+    for(auto i = m_demuxers.begin(); i != m_demuxers.end(); i++) {
+        TsDemuxer* dmx = *i;
+        TsStats stats = dmx->getStats();
+
+        p->put_U16(dmx->getPid());
+        p->put_U64(stats.packets);
+        p->put_U32(stats.bitRate);
+        p->put_U32(stats.ccErrors);
+        p->put_U32(stats.teiErrors);
+        p->put_U32(stats.scrambled);
+        p->put_U32(stats.overflows);
+        p->put_U32(stats.pcrJitter);
+        p->put_U32(stats.pcrInterval);
+    }
+
+    resumeDemuxers();
+}
+
+bool LiveChannel::isReady() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    suspendDemuxers();
+
+    bool ready = !m_demuxers.empty() && m_demuxers.isReady();
+
+    resumeDemuxers();
+    return ready;
+}
+
+void LiveChannel::suspendDemuxers() {
+    if(m_pool != NULL) {
+        m_pool->suspend();
+    }
+}
+
+void LiveChannel::resumeDemuxers() {
+    if(m_pool != NULL) {
+        m_pool->resume();
+    }
+}
+
+#if VDRVERSNUM < 20300
+void LiveChannel::Receive(uchar* Data, int Length)
+#else
+void LiveChannel::Receive(const uchar* Data, int Length)
+#endif
+{
+    if(m_pool != NULL) {
+        m_pool->process(Data, Length);
+        return;
+    }
+
+    // client threads read the stream information of the demuxers
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_demuxers.processTsPackets(Data, Length);
+}
+
+void LiveChannel::processChannelChange(const cChannel* channel) {
+    if(createChannelUid(channel) != m_uid) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> channelsLock(m_channelsMutex);
+
+    // every client of this channel forwards the change,
+    // only switch if the stream layout really changed
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(createFromChannel(channel).isMetaOf(m_channelBundle)) {
+            return;
+        }
+    }
+
+    isyslog("ChannelChange()");
+
+    Detach();
+    switchChannel(channel);
+}
+
+void LiveChannel::createDemuxers(StreamBundle* bundle) {
+    // finish pending work of the previous demuxers
+    if(m_pool != NULL) {
+        m_pool->drain();
+    }
+
+    // update demuxers
+    logOverflows();
+    m_demuxers.updateFrom(bundle);
+
+    // update pids
+    SetPids(nullptr);
+
+    for(auto i = m_demuxers.begin(); i != m_demuxers.end(); i++) {
+        TsDemuxer* dmx = *i;
+        AddPid(dmx->getPid());
+    }
+}
+
+void LiveChannel::logOverflows() {
+    for(auto i = m_demuxers.begin(); i != m_demuxers.end(); i++) {
+        TsDemuxer* dmx = *i;
+
+        if(dmx->getOverflowCount() > 0) {
+            esyslog("pid %i: %u frames lost (parser buffer overflow)", dmx->getPid(), dmx->getOverflowCount());
+        }
+    }
+}
+
+StreamBundle LiveChannel::createFromChannel(const cChannel* channel) {
+    StreamBundle item;
+
+    // add video stream
+    int vpid = channel->Vpid();
+    int vtype = channel->Vtype();
+
+    item.addStream(StreamInfo(vpid,
+                              vtype == 0x02 ? StreamInfo::Type::MPEG2VIDEO :
+                              vtype == 0x1b ? StreamInfo::Type::H264 :
+                              vtype == 0x24 ? StreamInfo::Type::H265 :
+                              StreamInfo::Type::NONE));
+
+    // add (E)AC3 streams
+    for(int i = 0; channel->Dpid(i) != 0; i++) {
+        int dtype = channel->Dtype(i);
+        item.addStream(StreamInfo(channel->Dpid(i),
+                                  dtype == 0x6A ? StreamInfo::Type::AC3 :
+                                  dtype == 0x7A ? StreamInfo::Type::EAC3 :
+                                  StreamInfo::Type::NONE,
+                                  channel->Dlang(i)));
+    }
+
+    // add audio streams
+    for(int i = 0; channel->Apid(i) != 0; i++) {
+        int atype = channel->Atype(i);
+        item.addStream(StreamInfo(channel->Apid(i),
+                                  atype == 0x04 ? StreamInfo::Type::MPEG2AUDIO :
+                                  atype == 0x03 ? StreamInfo::Type::MPEG2AUDIO :
+                                  atype == 0x0f ? StreamInfo::Type::AAC :
+                                  atype == 0x11 ? StreamInfo::Type::LATM :
+                                  StreamInfo::Type::NONE,
+                                  channel->Alang(i)));
+    }
+
+    // add subtitle streams
+    for(int i = 0; channel->Spid(i) != 0; i++) {
+        StreamInfo stream(channel->Spid(i), StreamInfo::Type::DVBSUB, channel->Slang(i));
+
+        stream.setSubtitlingDescriptor(
+                channel->SubtitlingType(i),
+                channel->CompositionPageId(i),
+                channel->AncillaryPageId(i));
+
+        item.addStream(stream);
+    }
+
+    return item;
+}
@@ -0,0 +1,150 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_LIVECHANNEL_H
+#define ROBOTV_LIVECHANNEL_H
+
+#include <vdr/channels.h>
+#include <vdr/device.h>
+#include <vdr/receiver.h>
+
+#include "robotvdmx/demuxer.h"
+#include "robotvdmx/streambundle.h"
+#include "robotvdmx/demuxerbundle.h"
+
+#include <list>
+#include <map>
+#include <mutex>
+
+class MsgPacket;
+class LiveQueue;
+class LiveStreamer;
+class PooledDemuxer;
+
+/**
+ * A live channel is shared by all clients watching the same channel.
+ * It runs a single receiver, demuxer set and timeshift buffer.
+ * Every client (LiveStreamer) just reads the timeshift buffer with
+ * its own read position.
+ */
+
+class LiveChannel : public cReceiver, public TsDemuxer::Listener {
+public:
+
+    static LiveChannel* attach(LiveStreamer* streamer, const cChannel* channel, int priority, bool cache, int& status);
+
+    static void detach(LiveStreamer* streamer, LiveChannel* channel);
+
+    // keep a channel running without clients (warm standby)
+    static bool addStandby(const cChannel* channel, bool cache);
+
+    static void removeStandby(uint32_t uid);
+
+    static bool isReceiving(uint32_t uid);
+
+    void processChannelChange(const cChannel* channel);
+
+    MsgPacket* createStreamChangePacket(const char* lang, StreamInfo::Type type);
+
+    MsgPacket* createSignalInfoPacket(bool streamStats);
+
+    // per PID transport stream statistics
+    void putStreamStats(MsgPacket* p);
+
+    bool isReady();
+
+    LiveQueue* getQueue() const {
+        return m_queue;
+    }
+
+    uint32_t getUid() const {
+        return m_uid;
+    }
+
+    // TsDemuxer::Listener implementation
+
+    void onStreamPacket(TsDemuxer::StreamPacket* pkt);
+
+    void onStreamChange();
+
+protected:
+
+#if VDRVERSNUM < 20300
+    void Receive(uchar* Data, int Length);
+#else
+    void Receive(const uchar* Data, int Length);
+#endif
+
+private:
+
+    LiveChannel(const cChannel* channel, int priority, bool cache);
+
+    virtual ~LiveChannel();
+
+    int switchChannel(const cChannel* channel, int priority = LIVEPRIORITY);
+
+    void sendStreamChange();
+
+    StreamBundle createFromChannel(const cChannel* channel);
+
+    void createDemuxers(StreamBundle* bundle);
+
+    void logOverflows();
+
+    // keep pooled demuxing off the demuxers while client threads read them
+    void suspendDemuxers();
+
+    void resumeDemuxers();
+
+    DemuxerBundle m_demuxers = NULL;
+
+    // demuxing on the worker pool (if enabled)
+    PooledDemuxer* m_pool = NULL;
+
+    LiveQueue* m_queue = NULL;
+
+    uint32_t m_uid;
+
+    bool m_requestStreamChange = false;
+
+    bool m_cacheEnabled;
+
+    bool m_standby = false;
+
+    StreamBundle m_channelBundle;
+
+    std::list<LiveStreamer*> m_streamers;
+
+    // protects the streamers and the demuxers (against the receiver thread)
+    std::mutex m_mutex;
+
+    static std::map<uint32_t, LiveChannel*> m_channels;
+
+    static std::mutex m_channelsMutex;
+
+    static int m_idCnt;
+
+};
+
+#endif // ROBOTV_LIVECHANNEL_H
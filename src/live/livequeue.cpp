@@ -25,9 +25,10 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <unistd.h>
-#include <fcntl.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "config/config.h"
 #include "net/msgpacket.h"
 #include "livequeue.h"
@@ -35,25 +36,34 @@
 
 cString LiveQueue::m_timeShiftDir = "/video";
 uint64_t LiveQueue::m_bufferSize = 1024 * 1024 * 1024;
+TimeShiftStorage::Type LiveQueue::m_storageType = TimeShiftStorage::Type::FILE;
+uint64_t LiveQueue::m_memorySize = 0;
 
-LiveQueue::LiveQueue(int socket) : m_readFd(-1), m_writeFd(-1), m_socket(socket) {
-    m_wrapped = false;
+LiveQueue::LiveQueue(int id) : m_writePosition(0), m_id(id) {
     m_hasWrapped = false;
     m_writerRunning = true;
     m_wrapCount = 0;
     m_queueStartTime = roboTV::currentTimeMillis();
     m_lastSyncTime = roboTV::currentTimeMillis();
     m_writeThread = nullptr;
+    m_latencySum = std::chrono::microseconds(0);
+    m_latencyMax = std::chrono::microseconds(0);
 }
 
 LiveQueue::~LiveQueue() {
-    m_writerRunning = false;
-    close();
+    {
+        std::lock_guard<std::mutex> lock(m_mutexQueue);
+        m_writerRunning = false;
+    }
+
+    m_writerCondition.notify_one();
 
     if(m_writeThread != nullptr) {
         m_writeThread->join();
     }
 
+    close();
+
     while(!m_writerQueue.empty()) {
         const PacketData& p = m_writerQueue.front();
         delete p.p;
@@ -61,7 +71,26 @@ LiveQueue::~LiveQueue() {
     }
 
     delete m_writeThread;
-    isyslog("LiveQueue terminated");
+
+    for(auto reader: m_readers) {
+        delete reader;
+    }
+
+    isyslog("LiveQueue terminated (write latency avg: %li us / max: %li us)",
+            (long)getAverageWriteLatency().count(),
+            (long)getMaxWriteLatency().count());
+
+    isyslog("LiveQueue timeshift tiers (memory hits: %lu / disk hits: %lu / spilled: %lu / discarded: %lu)",
+            (unsigned long)m_tierStats.memoryHits,
+            (unsigned long)m_tierStats.diskHits,
+            (unsigned long)m_tierStats.spilled,
+            (unsigned long)m_tierStats.discarded);
+
+    isyslog("LiveQueue dropped packets (disposable frames: %lu / dependent frames: %lu / auxiliary: %lu / overflow: %lu)",
+            (unsigned long)m_dropStats.disposableFrames,
+            (unsigned long)m_dropStats.dependentFrames,
+            (unsigned long)m_dropStats.auxiliary,
+            (unsigned long)m_dropStats.overflow);
 }
 
 void LiveQueue::start() {
@@ -73,119 +102,233 @@ void LiveQueue::start() {
     m_queueStartTime = roboTV::currentTimeMillis();
 
     m_writeThread = new std::thread([&]() {
-        createRingBuffer();
+        std::deque<PacketData> batch;
 
         while(m_writerRunning) {
 
-            while(m_writerRunning && !m_writerQueue.empty()) {
-                PacketData p;
-
-                {
-                    std::lock_guard<std::mutex> lock(m_mutexQueue);
-                    p = m_writerQueue.front();
-                    m_writerQueue.pop_front();
-                }
+            // wait until the receiver thread hands over packets
+            {
+                std::unique_lock<std::mutex> lock(m_mutexQueue);
+                m_writerCondition.wait(lock, [&]() {
+                    return !m_writerRunning || !m_writerQueue.empty();
+                });
 
-                write(p);
+                batch.swap(m_writerQueue);
             }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            // write all pending packets without holding the queue lock
+            while(!batch.empty()) {
+                write(batch.front());
+                batch.pop_front();
+            }
         }
     });
 
 }
 
 void LiveQueue::createRingBuffer() {
-    std::lock_guard<std::mutex> lock(m_mutex);
-
-    m_pause = false;
     off_t length = (off_t)m_bufferSize + 1024 * 1024;
 
-    m_storage = cString::sprintf("%s/robotv-ringbuffer-%05i.data", (const char*)m_timeShiftDir, m_socket);
-    dsyslog("timeshift file: %s", (const char*)m_storage);
+    m_storageFile = cString::sprintf("%s/robotv-ringbuffer-%05i.data", (const char*)m_timeShiftDir, m_id);
+    dsyslog("timeshift file: %s (%s)", (const char*)m_storageFile, TimeShiftStorage::typeName(m_storageType));
+
+    m_storage = TimeShiftStorage::create(m_storageType);
 
-    m_writeFd = open(m_storage, O_CREAT | O_WRONLY, 0644);
-    int rc = posix_fallocate(m_writeFd, 0, length);
+    // fallback to plain file i/o (e.g. if we run out of address space)
+    if(!m_storage->open(m_storageFile, length) && m_storageType != TimeShiftStorage::Type::FILE) {
+        esyslog("falling back to file based timeshift storage");
+        delete m_storage;
 
-    if(rc != 0) {
-        dsyslog("unable to pre-allocate %li bytes for timeshift ringbuffer", length);
-        dsyslog("ERROR: %s (status = %i)", strerror(rc), rc);
+        m_storage = TimeShiftStorage::create(TimeShiftStorage::Type::FILE);
+        m_storage->open(m_storageFile, length);
     }
+}
+
+LiveQueue::Reader* LiveQueue::attachReader(bool fromKeyFrame) {
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-    m_readFd = open(m_storage, O_NOATIME | O_RDONLY, 0644);
-    posix_fadvise(m_readFd, 0, length, POSIX_FADV_SEQUENTIAL);
+    // start reading at the current live position
+    Reader* reader = new Reader;
+    reader->readPosition = m_writePosition;
 
-    if(m_readFd == -1) {
-        esyslog("Failed to create timeshift ringbuffer !");
+    // or replay the current GOP, so the client can start decoding immediately
+    if(fromKeyFrame && !m_index.empty()) {
+        const KeyFrameIndex::Entry& e = m_index.back();
+
+        if(roboTV::currentTimeMillis() - e.wallclockTime <= m_maxGopDuration) {
+            reader->readPosition = e.filePosition;
+            reader->wrapped = (e.wrapCount < m_wrapCount);
+        }
     }
 
-    lseek(m_readFd, 0, SEEK_SET);
-    lseek(m_writeFd, 0, SEEK_SET);
+    m_readers.push_back(reader);
+    return reader;
+}
+
+void LiveQueue::detachReader(Reader* reader) {
+    std::lock_guard<std::mutex> lock(m_mutex);
 
+    m_readers.remove(reader);
+    delete reader;
 }
 
-MsgPacket* LiveQueue::read(bool keyFrameMode) {
+std::shared_ptr<MsgPacket> LiveQueue::read(Reader* reader, bool keyFrameMode) {
     std::lock_guard<std::mutex> lock(m_mutex);
 
-    if(m_pause) {
-        return NULL;
+    if(reader->pause) {
+        return nullptr;
     }
 
     if(keyFrameMode) {
-        seekNextKeyFrame();
+        seekNextKeyFrame(reader);
     }
 
-    return internalRead();
+    return internalRead(reader);
 }
 
-MsgPacket* LiveQueue::internalRead() {
+std::shared_ptr<MsgPacket> LiveQueue::internalRead(Reader* reader, bool skip) {
     // check if read position wrapped
 
-    off_t readPosition = lseek(m_readFd, 0, SEEK_CUR);
-    off_t writePosition = lseek(m_writeFd, 0, SEEK_CUR);
-
-    if(readPosition == (off_t)-1 || writePosition == (off_t)-1) {
-        return nullptr;
-    }
+    if(reader->readPosition >= (off_t)m_bufferSize) {
+        // writer didn't wrap yet, no more data available
+        if(!reader->wrapped) {
+            return nullptr;
+        }
 
-    if(readPosition >= (off_t)m_bufferSize) {
         isyslog("timeshift: read buffer wrap");
-        lseek(m_readFd, 0, SEEK_SET);
-        readPosition = 0;
-        m_wrapped = !m_wrapped;
-        isyslog("wrapped: %s", m_wrapped ? "yes" : "no");
+        reader->readPosition = 0;
+        reader->wrapped = !reader->wrapped;
+        isyslog("wrapped: %s", reader->wrapped ? "yes" : "no");
     }
 
     // check if read position is still behind write position (if not wrapped))
     // if not -> skip packet (as we would start reading from the beginning of
     // the buffer)
 
-    if(readPosition >= writePosition && !m_wrapped) {
+    if(reader->readPosition >= m_writePosition && !reader->wrapped) {
         return nullptr;
     }
 
-    // read packet from storage
-    return MsgPacket::read(m_readFd, 1000);
+    // recent packets are served from memory, older ones from disk
+    int wrapCount = reader->wrapped ? m_wrapCount - 1 : m_wrapCount;
+    std::shared_ptr<MsgPacket> p = m_memory.read(reader->readPosition, wrapCount);
+
+    bool memoryHit = (p != nullptr);
+
+    if(!memoryHit && m_storage != nullptr) {
+        p.reset(m_storage->read(reader->readPosition));
+    }
+
+    // only reads delivered to the client count as tier hits
+    if(p != nullptr && !skip) {
+        if(memoryHit) {
+            m_tierStats.memoryHits++;
+        }
+        else {
+            m_tierStats.diskHits++;
+        }
+    }
+
+    if(p != nullptr) {
+        reader->readPosition += p->getPacketLength();
+    }
+
+    return p;
 }
 
-bool LiveQueue::isPaused() {
+bool LiveQueue::isPaused(Reader* reader) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_pause;
+    return reader->pause;
 }
 
 void LiveQueue::queue(MsgPacket* p, StreamInfo::Content content, int64_t pts) {
     start();
 
+    bool wakeup = false;
+
     {
         std::lock_guard<std::mutex> lock(m_mutexQueue);
 
-        if (m_writerQueue.size() >= 400) {
+        if(!acceptPacket(p, content)) {
             delete p;
             return;
         }
 
-        m_writerQueue.push_back({p, content, pts});
+        // the writer only sleeps on an empty queue
+        wakeup = m_writerQueue.empty();
+        m_writerQueue.push_back({p, content, pts, std::chrono::steady_clock::now()});
+    }
+
+    if(wakeup) {
+        m_writerCondition.notify_one();
+    }
+}
+
+bool LiveQueue::acceptPacket(MsgPacket* p, StreamInfo::Content content) {
+    size_t queueSize = m_writerQueue.size();
+
+    // last resort - never let the queue grow unbounded
+    if(queueSize >= m_queueOverflowLimit) {
+        m_dropStats.overflow++;
+
+        if(content == StreamInfo::Content::VIDEO) {
+            m_dropDependentFrames = true;
+        }
+
+        return false;
+    }
+
+    if(content == StreamInfo::Content::VIDEO) {
+        StreamInfo::FrameType frameType = (StreamInfo::FrameType)p->getClientID();
+
+        // a keyframe ends the dropped GOP, the decoder restarts cleanly
+        if(frameType == StreamInfo::FrameType::IFRAME) {
+            m_dropDependentFrames = false;
+            return true;
+        }
+
+        // congested -> drop the rest of the GOP, the decoder can't use
+        // frames referencing a dropped frame anyway
+        if(queueSize >= m_queueDependentLimit) {
+            m_dropDependentFrames = true;
+        }
+
+        if(m_dropDependentFrames) {
+            if(queueSize >= m_queueHardLimit) {
+                m_dropStats.overflow++;
+            }
+            else {
+                m_dropStats.dependentFrames++;
+            }
+
+            return false;
+        }
+
+        // B-frames are never referenced, dropping them keeps the GOP intact
+        bool disposable = (frameType == StreamInfo::FrameType::BFRAME || frameType == StreamInfo::FrameType::DFRAME);
+
+        if(disposable && queueSize >= m_queueSoftLimit) {
+            m_dropStats.disposableFrames++;
+            return false;
+        }
+
+        return true;
     }
+
+    // subtitles and teletext are expendable
+    if(queueSize >= m_queueSoftLimit &&
+       (content == StreamInfo::Content::SUBTITLE || content == StreamInfo::Content::TELETEXT)) {
+        m_dropStats.auxiliary++;
+        return false;
+    }
+
+    // audio and stream info are kept up to the overflow limit
+    return true;
+}
+
+LiveQueue::DropStats LiveQueue::getDropStats() {
+    std::lock_guard<std::mutex> lock(m_mutexQueue);
+    return m_dropStats;
 }
 
 bool LiveQueue::write(const PacketData& data) {
@@ -198,37 +341,36 @@ bool LiveQueue::write(const PacketData& data) {
 
 
     // first packet set start time
-    if(m_indexList.empty()) {
+    if(m_index.empty()) {
         m_queueStartTime = roboTV::currentTimeMillis();
     }
 
     // ring-buffer overrun ?
 
-    off_t writePosition = lseek(m_writeFd, 0, SEEK_CUR);
-    off_t readPosition = lseek(m_readFd, 0, SEEK_CUR);
-
-    if(writePosition >= (off_t) m_bufferSize) {
+    if(m_writePosition >= (off_t) m_bufferSize) {
         isyslog("timeshift: write buffer wrap");
-        lseek(m_writeFd, 0, SEEK_SET);
-        writePosition = 0;
+        m_writePosition = 0;
 
-        m_wrapped = !m_wrapped;
         m_hasWrapped = true;
         m_wrapCount++;
 
-        isyslog("wrapped: %s", m_wrapped ? "yes" : "no");
+        for(auto reader: m_readers) {
+            reader->wrapped = !reader->wrapped;
+        }
     }
 
-    off_t packetEndPosition = writePosition + p->getPacketLength();
+    off_t packetEndPosition = m_writePosition + p->getPacketLength();
 
-    // check if write position if still behind read position (if wrapped)
-    // if not -> shift read position forward
+    // check if write position if still behind read positions (if wrapped)
+    // if not -> shift read positions forward
 
-    while(packetEndPosition >= readPosition && m_wrapped) {
-        if(internalRead() == nullptr) {
-            esyslog("write overlap - wrapped read position behind write position !");
-            delete p;
-            return false;
+    for(auto reader: m_readers) {
+        while(packetEndPosition >= reader->readPosition && reader->wrapped) {
+            if(internalRead(reader, true) == nullptr) {
+                esyslog("write overlap - wrapped read position behind write position !");
+                delete p;
+                return false;
+            }
         }
     }
 
@@ -238,15 +380,14 @@ bool LiveQueue::write(const PacketData& data) {
     bool keyFrame = (p->getClientID() == (uint16_t)StreamInfo::FrameType::IFRAME);
 
     if(keyFrame && content == StreamInfo::Content::VIDEO) {
-        m_indexList.push_back({writePosition, timeStamp, pts, m_wrapCount});
+        m_index.add(m_writePosition, timeStamp, pts, m_wrapCount);
     }
 
-    // write packet
-    bool success = p->write(m_writeFd, 1000);
+    // write packet into the memory tier
+    m_memory.push(m_writePosition, m_wrapCount, p);
+    m_writePosition = packetEndPosition;
 
-    if(!success) {
-        esyslog("Unable to write packet into timeshift ringbuffer !");
-    }
+    evictMemory();
 
     // sync every 2 seconds
     // we just want to avoid delays of the write-back cache hitting
@@ -254,52 +395,125 @@ bool LiveQueue::write(const PacketData& data) {
 
     std::chrono::milliseconds now = roboTV::currentTimeMillis();
 
-    if(now - m_lastSyncTime >= std::chrono::milliseconds(2000)) {
-        if(fdatasync(m_writeFd) != 0) {
-            esyslog("Failed to sync timeshift ring-buffer !");
-        }
-
+    if(m_storageDirty && now - m_lastSyncTime >= std::chrono::milliseconds(2000)) {
+        m_storage->sync();
+        m_storageDirty = false;
         m_lastSyncTime = now;
     }
 
-    delete p;
-    return success;
+    // update write latency
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - data.queueTime);
+
+    m_latencySum += latency;
+    m_latencyCount++;
+
+    if(latency > m_latencyMax) {
+        m_latencyMax = latency;
+    }
+
+    return true;
+}
+
+bool LiveQueue::isBehind(Reader* reader, off_t position, int wrapCount) {
+    int readerWrapCount = reader->wrapped ? m_wrapCount - 1 : m_wrapCount;
+    return (readerWrapCount < wrapCount || (readerWrapCount == wrapCount && reader->readPosition <= position));
+}
+
+bool LiveQueue::isCurrentGop(const TimeShiftMemoryTier::Entry& e) {
+    if(m_index.empty()) {
+        return false;
+    }
+
+    const KeyFrameIndex::Entry& k = m_index.back();
+    return (e.wrapCount > k.wrapCount || (e.wrapCount == k.wrapCount && e.position >= k.filePosition));
+}
+
+bool LiveQueue::spill(const TimeShiftMemoryTier::Entry& e) {
+    if(m_storage == nullptr) {
+        createRingBuffer();
+    }
+
+    if(!m_storage->write(e.position, e.packet.get())) {
+        esyslog("Unable to write packet into timeshift ringbuffer !");
+        return false;
+    }
+
+    m_tierStats.spilled++;
+    m_storageDirty = true;
+
+    return true;
+}
+
+void LiveQueue::evictMemory() {
+    // the memory tier never holds more than one buffer lap
+    uint64_t memorySize = std::min(m_memorySize, m_bufferSize);
+    uint64_t maxGopSize = std::min(m_maxGopSize, m_bufferSize / 2);
+
+    while(!m_memory.empty() && m_memory.bytes() > memorySize) {
+
+        // keep the current GOP for clients starting at the last keyframe
+        if(isCurrentGop(m_memory.front()) && m_memory.bytes() <= maxGopSize) {
+            break;
+        }
+
+        TimeShiftMemoryTier::Entry e = m_memory.pop();
+
+        // evicted packets go to the timeshift file, so clients can still
+        // rewind behind the memory tier (the file is a ring buffer of
+        // MaxTimeShiftSize, trim() drops whatever it overwrites).
+        // queues without readers (standby) never create a timeshift file
+        if(!m_readers.empty() && spill(e)) {
+            continue;
+        }
+
+        // drop the packet - the timeshift buffer now starts behind it
+        off_t endPosition = e.position + e.packet->getPacketLength();
+        m_tierStats.discarded++;
+
+        for(auto reader: m_readers) {
+            if(isBehind(reader, e.position, e.wrapCount)) {
+                reader->readPosition = endPosition;
+                reader->wrapped = (e.wrapCount < m_wrapCount);
+            }
+        }
+
+        m_index.trimBefore(endPosition, e.wrapCount);
+
+        if(!m_index.empty()) {
+            m_queueStartTime = m_index.front().wallclockTime;
+        }
+    }
 }
 
 void LiveQueue::close() {
-    ::close(m_readFd);
-    ::close(m_writeFd);
+    delete m_storage;
+    m_storage = nullptr;
 
-    if(*m_storage) {
-        unlink(m_storage);
+    if(*m_storageFile) {
+        unlink(m_storageFile);
     }
 }
 
 void LiveQueue::trim(off_t position) {
-    if(!m_hasWrapped || m_indexList.empty()) {
+    if(!m_hasWrapped) {
         return;
     }
 
-    auto p = m_indexList.front();
+    m_index.trim(position, m_wrapCount);
 
-    if(p.filePosition < position && p.wrapCount < m_wrapCount) {
-        m_indexList.pop_front();
-    }
-
-    if(!m_indexList.empty()) {
-        auto p = m_indexList.front();
-        m_queueStartTime = p.wallclockTime;
+    if(!m_index.empty()) {
+        m_queueStartTime = m_index.front().wallclockTime;
     }
 }
 
-bool LiveQueue::pause(bool on) {
+bool LiveQueue::pause(Reader* reader, bool on) {
     std::lock_guard<std::mutex> lock(m_mutex);
 
-    if(m_pause == on) {
+    if(reader->pause == on) {
         return false;
     }
 
-    m_pause = on;
+    reader->pause = on;
     return true;
 }
 
@@ -313,6 +527,21 @@ void LiveQueue::setBufferSize(uint64_t s) {
     isyslog("timeshift buffersize: %lu bytes", m_bufferSize);
 }
 
+void LiveQueue::setMemorySize(uint64_t s) {
+    m_memorySize = s;
+    isyslog("timeshift memory tier: %lu bytes", m_memorySize);
+}
+
+LiveQueue::TierStats LiveQueue::getTierStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tierStats;
+}
+
+void LiveQueue::setStorageType(TimeShiftStorage::Type type) {
+    m_storageType = type;
+    isyslog("timeshift storage: %s", TimeShiftStorage::typeName(m_storageType));
+}
+
 void LiveQueue::removeTimeShiftFiles() {
     DIR* dir = opendir((const char*)m_timeShiftDir);
 
@@ -332,71 +561,53 @@ void LiveQueue::removeTimeShiftFiles() {
     closedir(dir);
 }
 
-int64_t LiveQueue::seek(int64_t wallclockPositionMs) {
+int64_t LiveQueue::seek(Reader* reader, int64_t wallclockPositionMs) {
     std::lock_guard<std::mutex> lock(m_mutex);
 
     isyslog("seek: %lu", wallclockPositionMs);
 
-    auto s = m_indexList.rbegin();
-    auto e = m_indexList.rend();
-    auto h = m_indexList.begin();
+    auto i = m_index.findByTime(wallclockPositionMs);
 
-    if(s == e) {
+    if(i == m_index.end()) {
         esyslog("empty timeshift queue - unable to seek");
         return 0;
     }
 
-    // ahead of buffer
-    if(wallclockPositionMs >= s->wallclockTime.count()) {
-        lseek(m_readFd, s->filePosition, SEEK_SET);
-        return s->pts;
-    }
+    reader->readPosition = i->filePosition;
+    reader->wrapped = (i->wrapCount < m_wrapCount);
 
-    // behind buffer
-    else if(wallclockPositionMs <= h->wallclockTime.count()) {
-        lseek(m_readFd, h->filePosition, SEEK_SET);
-        return h->pts;
-    }
+    return i->pts;
+}
 
-    // in between ?
-    while(s != e) {
-        if(s->wallclockTime.count() <= wallclockPositionMs) {
-            lseek(m_readFd, s->filePosition, SEEK_SET);
-            return s->pts;
-        }
+void LiveQueue::seekNextKeyFrame(Reader* reader) {
+    // a wrapped reader is still reading the previous buffer lap
+    int wrapCount = reader->wrapped ? m_wrapCount - 1 : m_wrapCount;
 
-        s++;
+    auto i = m_index.findByPosition(reader->readPosition, wrapCount);
+
+    if(i == m_index.end()) {
+        return;
     }
 
-    // not found
-    esyslog("fileposition not found!");
-    return 0;
+    reader->readPosition = i->filePosition;
+    reader->wrapped = (i->wrapCount < m_wrapCount);
 }
 
-void LiveQueue::seekNextKeyFrame() {
-    off_t readPosition = lseek(m_readFd, 0, SEEK_CUR);
-
-    auto i = m_indexList.begin();
-    auto j = i;
-
-    while(i != m_indexList.end()) {
-        j++;
-
-        if(j == m_indexList.end()) {
-            return;
-        }
+int64_t LiveQueue::getTimeshiftStartPosition() {
+    return m_queueStartTime.count();
+}
 
-        if(i->filePosition < readPosition && readPosition <= j->filePosition) {
-            readPosition = j->filePosition;
-            break;
-        }
+std::chrono::microseconds LiveQueue::getAverageWriteLatency() {
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-        i++;
+    if(m_latencyCount == 0) {
+        return std::chrono::microseconds(0);
     }
 
-    lseek(m_readFd, readPosition, SEEK_SET);
+    return m_latencySum / m_latencyCount;
 }
 
-int64_t LiveQueue::getTimeshiftStartPosition() {
-    return m_queueStartTime.count();
+std::chrono::microseconds LiveQueue::getMaxWriteLatency() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_latencyMax;
 }
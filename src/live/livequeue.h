@@ -26,58 +26,98 @@
 #define ROBOTV_LIVEQUEUE_H
 
 #include "robotvdmx/streaminfo.h"
+#include "timeshiftstorage.h"
+#include "keyframeindex.h"
+#include "timeshiftmemorytier.h"
 
 #include <deque>
 #include <chrono>
 #include <mutex>
 #include <list>
+#include <memory>
 #include <thread>
 #include <atomic>
+#include <condition_variable>
 
 class MsgPacket;
 
 class LiveQueue {
 public:
 
-    LiveQueue(int socket);
+    // read position of a single client within the shared ringbuffer
+    struct Reader {
+        off_t readPosition = 0;
+        bool wrapped = false;
+        bool pause = false;
+    };
+
+    // packets dropped by the congestion policy
+    struct DropStats {
+        uint64_t disposableFrames = 0;
+        uint64_t dependentFrames = 0;
+        uint64_t auxiliary = 0;
+        uint64_t overflow = 0;
+    };
+
+    // reads served by each timeshift tier
+    struct TierStats {
+        uint64_t memoryHits = 0;
+        uint64_t diskHits = 0;
+        uint64_t spilled = 0;
+        uint64_t discarded = 0;
+    };
+
+    LiveQueue(int id);
 
     virtual ~LiveQueue();
 
     void queue(MsgPacket* p, StreamInfo::Content content, int64_t pts = 0);
 
-    MsgPacket* read(bool keyFrameMode = false);
+    Reader* attachReader(bool fromKeyFrame = false);
+
+    void detachReader(Reader* reader);
+
+    std::shared_ptr<MsgPacket> read(Reader* reader, bool keyFrameMode = false);
 
-    int64_t seek(int64_t wallclockPositionMs);
+    int64_t seek(Reader* reader, int64_t wallclockPositionMs);
 
-    bool pause(bool on = true);
+    bool pause(Reader* reader, bool on = true);
 
-    bool isPaused();
+    bool isPaused(Reader* reader);
 
     static void setTimeShiftDir(const cString& dir);
 
     static void setBufferSize(uint64_t s);
 
+    static void setStorageType(TimeShiftStorage::Type type);
+
+    static void setMemorySize(uint64_t s);
+
     static void removeTimeShiftFiles();
 
     int64_t getTimeshiftStartPosition();
 
+    std::chrono::microseconds getAverageWriteLatency();
+
+    std::chrono::microseconds getMaxWriteLatency();
+
+    DropStats getDropStats();
+
+    TierStats getTierStats();
+
 protected:
 
     struct PacketData {
         MsgPacket* p;
         StreamInfo::Content content;
         int64_t pts;
-    };
-
-    struct PacketIndex {
-        off_t filePosition;
-        std::chrono::milliseconds wallclockTime;
-        int64_t pts;
-        int wrapCount;
+        std::chrono::steady_clock::time_point queueTime;
     };
 
     bool write(const PacketData& data);
 
+    bool acceptPacket(MsgPacket* p, StreamInfo::Content content);
+
     void start();
 
     void createRingBuffer();
@@ -86,28 +126,41 @@ protected:
 
     void trim(off_t position);
 
-    MsgPacket* internalRead();
+    void evictMemory();
+
+    bool spill(const TimeShiftMemoryTier::Entry& e);
+
+    bool isBehind(Reader* reader, off_t position, int wrapCount);
 
-    void seekNextKeyFrame();
+    bool isCurrentGop(const TimeShiftMemoryTier::Entry& e);
 
-    std::deque<struct PacketIndex> m_indexList;
+    // skip: the packet is dropped by the writer, not delivered to the client
+    std::shared_ptr<MsgPacket> internalRead(Reader* reader, bool skip = false);
 
-    int m_readFd;
+    void seekNextKeyFrame(Reader* reader);
 
-    int m_writeFd;
+    KeyFrameIndex m_index;
 
-    int m_socket;
+    std::list<Reader*> m_readers;
 
-    bool m_pause;
+    TimeShiftStorage* m_storage = nullptr;
+
+    TimeShiftMemoryTier m_memory;
+
+    bool m_storageDirty = false;
+
+    TierStats m_tierStats;
+
+    off_t m_writePosition;
+
+    int m_id;
 
     std::mutex m_mutex;
 
-    cString m_storage;
+    cString m_storageFile;
 
     std::chrono::milliseconds m_queueStartTime;
 
-    bool m_wrapped;
-
     bool m_hasWrapped;
 
     int m_wrapCount;
@@ -116,6 +169,16 @@ protected:
 
     static uint64_t m_bufferSize;
 
+    static TimeShiftStorage::Type m_storageType;
+
+    static uint64_t m_memorySize;
+
+    // don't replay GOPs longer than this on attach
+    const std::chrono::milliseconds m_maxGopDuration = std::chrono::milliseconds(10000);
+
+    // upper limit of the GOP kept in the memory tier
+    const uint64_t m_maxGopSize = 16 * 1024 * 1024;
+
 private:
 
     std::thread* m_writeThread;
@@ -128,6 +191,30 @@ private:
 
     std::mutex m_mutexQueue;
 
+    std::condition_variable m_writerCondition;
+
+    // congestion policy (guarded by m_mutexQueue)
+    // soft limit: drop B-frames, dependent limit: drop the rest of the GOP,
+    // hard limit: keep keyframes and audio only, overflow limit: drop everything
+    const size_t m_queueSoftLimit = 400;
+
+    const size_t m_queueDependentLimit = 600;
+
+    const size_t m_queueHardLimit = 800;
+
+    const size_t m_queueOverflowLimit = 1600;
+
+    bool m_dropDependentFrames = false;
+
+    DropStats m_dropStats;
+
+    // enqueue-to-disk latency statistics (guarded by m_mutex)
+    uint64_t m_latencyCount = 0;
+
+    std::chrono::microseconds m_latencySum;
+
+    std::chrono::microseconds m_latencyMax;
+
 };
 
 #endif // ROBOTV_LIVEQUEUE_H
@@ -0,0 +1,151 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <vdr/tools.h>
+
+#include "livesessions.h"
+#include "livestreamer.h"
+
+#include <list>
+
+std::chrono::seconds LiveSessions::m_timeout(60);
+
+LiveSessions::LiveSessions() {
+}
+
+LiveSessions::~LiveSessions() {
+    clear();
+}
+
+LiveSessions& LiveSessions::instance() {
+    static LiveSessions sessions;
+    return sessions;
+}
+
+void LiveSessions::setTimeout(int seconds) {
+    m_timeout = std::chrono::seconds(seconds);
+    isyslog("timeshift session timeout: %i seconds", seconds);
+}
+
+void LiveSessions::park(const std::string& token, const std::string& owner, LiveStreamer* streamer) {
+    if(m_timeout.count() <= 0) {
+        delete streamer;
+        return;
+    }
+
+    // the client connection is gone
+    streamer->park();
+
+    LiveStreamer* replaced = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto i = m_sessions.find(token);
+
+        if(i != m_sessions.end()) {
+            // don't let a client take over a session of someone else
+            if(i->second.owner != owner) {
+                esyslog("timeshift session '%s' belongs to another client", token.c_str());
+                replaced = streamer;
+                streamer = nullptr;
+            }
+            else {
+                replaced = i->second.streamer;
+            }
+        }
+
+        if(streamer != nullptr) {
+            m_sessions[token] = {streamer, owner, std::chrono::steady_clock::now()};
+        }
+    }
+
+    // destroy the replaced (or rejected) streamer without holding the lock
+    delete replaced;
+
+    if(streamer != nullptr) {
+        isyslog("timeshift session '%s' parked", token.c_str());
+    }
+}
+
+LiveStreamer* LiveSessions::resume(const std::string& token, const std::string& owner) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto i = m_sessions.find(token);
+
+    if(i == m_sessions.end()) {
+        return nullptr;
+    }
+
+    if(i->second.owner != owner) {
+        esyslog("timeshift session '%s' belongs to another client", token.c_str());
+        return nullptr;
+    }
+
+    LiveStreamer* streamer = i->second.streamer;
+    m_sessions.erase(i);
+
+    isyslog("timeshift session '%s' resumed", token.c_str());
+    return streamer;
+}
+
+void LiveSessions::remove(const std::string& token, const std::string& owner) {
+    delete resume(token, owner);
+}
+
+void LiveSessions::cleanup() {
+    std::list<LiveStreamer*> expired;
+    auto now = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for(auto i = m_sessions.begin(); i != m_sessions.end();) {
+            if(now - i->second.parkTime < m_timeout) {
+                i++;
+                continue;
+            }
+
+            isyslog("timeshift session '%s' expired", i->first.c_str());
+            expired.push_back(i->second.streamer);
+            i = m_sessions.erase(i);
+        }
+    }
+
+    // streamers detach from their channels - do this without holding the lock
+    for(auto streamer: expired) {
+        delete streamer;
+    }
+}
+
+void LiveSessions::clear() {
+    std::map<std::string, Session> sessions;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        sessions.swap(m_sessions);
+    }
+
+    for(auto& i: sessions) {
+        delete i.second.streamer;
+    }
+}
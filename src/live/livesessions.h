@@ -0,0 +1,86 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_LIVESESSIONS_H
+#define ROBOTV_LIVESESSIONS_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+class LiveStreamer;
+
+/**
+ * Timeshift sessions of disconnected clients.
+ *
+ * A streamer with a session token is parked here instead of being
+ * destroyed when its client connection drops. It keeps the channel,
+ * the timeshift buffer and its read position alive until the client
+ * resumes the session or the grace period expires. A session is bound
+ * to the client name it was parked by and can only be resumed or
+ * removed by a client logged in with the same name.
+ */
+
+class LiveSessions {
+public:
+
+    void park(const std::string& token, const std::string& owner, LiveStreamer* streamer);
+
+    LiveStreamer* resume(const std::string& token, const std::string& owner);
+
+    void remove(const std::string& token, const std::string& owner);
+
+    // destroy all sessions whose grace period has expired
+    void cleanup();
+
+    void clear();
+
+    static void setTimeout(int seconds);
+
+    static LiveSessions& instance();
+
+protected:
+
+    LiveSessions();
+
+    virtual ~LiveSessions();
+
+private:
+
+    struct Session {
+        LiveStreamer* streamer;
+        std::string owner;
+        std::chrono::steady_clock::time_point parkTime;
+    };
+
+    std::map<std::string, Session> m_sessions;
+
+    std::mutex m_mutex;
+
+    static std::chrono::seconds m_timeout;
+
+};
+
+#endif // ROBOTV_LIVESESSIONS_H
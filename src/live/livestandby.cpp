@@ -0,0 +1,213 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <vdr/channels.h>
+
+#include "config/config.h"
+#include "robotv/robotvchannels.h"
+#include "tools/hash.h"
+
+#include "livestandby.h"
+#include "livechannel.h"
+
+#include <algorithm>
+#include <list>
+
+int LiveStandby::m_count = 0;
+
+LiveStandby::LiveStandby() {
+}
+
+LiveStandby& LiveStandby::instance() {
+    static LiveStandby standby;
+    return standby;
+}
+
+void LiveStandby::setCount(int count) {
+    m_count = count;
+    isyslog("standby receivers: %i", m_count);
+}
+
+void LiveStandby::update(unsigned int clientId, const cChannel* channel) {
+    if(m_count <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t uid = createChannelUid(channel);
+    auto i = m_clients.find(clientId);
+
+    if(i == m_clients.end()) {
+        m_clients[clientId] = {uid, 0};
+    }
+    else if(i->second.current != uid) {
+        i->second.previous = i->second.current;
+        i->second.current = uid;
+    }
+
+    m_dirty = true;
+}
+
+void LiveStandby::remove(unsigned int clientId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_clients.erase(clientId) > 0) {
+        m_dirty = true;
+    }
+}
+
+void LiveStandby::process() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // drop standby receivers that lost their device
+    for(auto i = m_standby.begin(); i != m_standby.end();) {
+        if(LiveChannel::isReceiving(*i)) {
+            i++;
+            continue;
+        }
+
+        LiveChannel::removeStandby(*i);
+        i = m_standby.erase(i);
+    }
+
+    // retry from time to time (devices may have become idle)
+    auto now = std::chrono::steady_clock::now();
+
+    if(!m_dirty && now - m_lastUpdate < std::chrono::seconds(30)) {
+        return;
+    }
+
+    m_dirty = false;
+    m_lastUpdate = now;
+
+    // collect the most likely next channels of all clients
+    // (channel uids, the channel objects are only valid under the lock)
+    std::list<uint32_t> candidates;
+    std::set<uint32_t> watched;
+
+    RoboTVChannels& c = RoboTVChannels::instance();
+    c.lock(false);
+    cChannels* channels = c.get();
+
+    for(auto& i: m_clients) {
+        watched.insert(i.second.current);
+        const cChannel* current = nullptr;
+
+        for(cChannel* channel = channels->First(); channel; channel = channels->Next(channel)) {
+            uint32_t uid = createChannelUid(channel);
+
+            if(uid == i.second.current) {
+                current = channel;
+            }
+            else if(uid == i.second.previous && !channel->GroupSep()) {
+                candidates.push_front(uid);
+            }
+        }
+
+        if(current == nullptr) {
+            continue;
+        }
+
+        for(int direction: { 1, -1 }) {
+            const cChannel* channel = channels->GetByNumber(current->Number() + direction, direction);
+
+            if(channel != nullptr && !channel->GroupSep()) {
+                candidates.push_back(createChannelUid(channel));
+            }
+        }
+    }
+
+    c.unlock();
+
+    std::set<uint32_t> standby;
+    std::list<uint32_t> start;
+
+    for(auto uid: candidates) {
+        if((int)standby.size() >= m_count) {
+            break;
+        }
+
+        if(watched.count(uid) > 0 || standby.count(uid) > 0) {
+            continue;
+        }
+
+        standby.insert(uid);
+
+        if(m_standby.count(uid) == 0) {
+            start.push_back(uid);
+        }
+    }
+
+    // stop receivers we don't need anymore
+    for(auto uid: m_standby) {
+        if(standby.count(uid) == 0) {
+            LiveChannel::removeStandby(uid);
+        }
+    }
+
+    m_standby.clear();
+
+    for(auto uid: standby) {
+        if(LiveChannel::isReceiving(uid)) {
+            m_standby.insert(uid);
+        }
+    }
+
+    // start new standby receivers
+    bool cache = RoboTVServerConfig::instance().channelCache;
+
+    if(start.empty()) {
+        return;
+    }
+
+    // resolve the uids again, the channel list may have changed meanwhile
+    c.lock(false);
+    channels = c.get();
+
+    for(cChannel* channel = channels->First(); channel; channel = channels->Next(channel)) {
+        uint32_t uid = createChannelUid(channel);
+
+        if(std::find(start.begin(), start.end(), uid) == start.end()) {
+            continue;
+        }
+
+        if(LiveChannel::addStandby(channel, cache)) {
+            m_standby.insert(uid);
+        }
+    }
+
+    c.unlock();
+}
+
+void LiveStandby::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for(auto uid: m_standby) {
+        LiveChannel::removeStandby(uid);
+    }
+
+    m_standby.clear();
+    m_clients.clear();
+}
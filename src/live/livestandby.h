@@ -0,0 +1,88 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_LIVESTANDBY_H
+#define ROBOTV_LIVESTANDBY_H
+
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+
+class cChannel;
+
+/**
+ * Warm standby receivers.
+ *
+ * Keeps the channels a client will most likely switch to next (the
+ * neighbouring channels and the previously watched one) running on
+ * otherwise idle devices. Switching to such a channel just attaches
+ * to the running LiveChannel. Standby receivers run with the lowest
+ * priority, so they yield to real viewers and recordings.
+ */
+
+class LiveStandby {
+public:
+
+    // a client started watching a channel
+    void update(unsigned int clientId, const cChannel* channel);
+
+    void remove(unsigned int clientId);
+
+    // start / stop standby receivers (called periodically)
+    void process();
+
+    void clear();
+
+    static void setCount(int count);
+
+    static LiveStandby& instance();
+
+protected:
+
+    LiveStandby();
+
+private:
+
+    struct Client {
+        uint32_t current;
+        uint32_t previous;
+    };
+
+    std::map<unsigned int, Client> m_clients;
+
+    std::set<uint32_t> m_standby;
+
+    bool m_dirty = false;
+
+    std::chrono::steady_clock::time_point m_lastUpdate;
+
+    std::mutex m_mutex;
+
+    static int m_count;
+
+};
+
+#endif // ROBOTV_LIVESTANDBY_H
@@ -23,25 +23,16 @@
  */
 
 #include <stdlib.h>
-#include <vdr/remux.h>
-#include <vdr/timers.h>
-
-#ifdef __FreeBSD__
-#include <sys/endian.h>
-#else
-#include <endian.h>
-#endif
 
 #include "config/config.h"
 #include "net/msgpacket.h"
 #include "robotv/robotvcommand.h"
 #include "robotv/robotvclient.h"
-#include "tools/hash.h"
 #include "tools/time.h"
 
 #include "livestreamer.h"
+#include "livechannel.h"
 #include "livequeue.h"
-#include "channelcache.h"
 
 #include <chrono>
 
@@ -50,36 +41,23 @@
 using namespace std::chrono;
 
 LiveStreamer::LiveStreamer(RoboTvClient* parent, const cChannel* channel, int priority, bool cache)
-    : cReceiver(nullptr, priority)
-    , m_demuxers(this)
-    , m_parent(parent)
+    : m_parent(parent)
+    , m_priority(priority)
     , m_cacheEnabled(cache) {
-    m_uid = createChannelUid(channel);
-
-    // create send queue
-    m_queue = new LiveQueue(m_parent->getSocket());
 }
 
 LiveStreamer::~LiveStreamer() {
-    cDevice * device = Device();
-
-    if(device != nullptr) {
-        cCamSlot *camSlot = device->CamSlot();
-
-        if (camSlot != nullptr) {
-            isyslog("camslot detached");
-            ChannelCamRelations.ClrChecked(ChannelID(), camSlot->SlotNumber());
-        }
-
-        Detach();
+    if(m_channel != nullptr) {
+        m_channel->getQueue()->detachReader(m_reader);
+        LiveChannel::detach(this, m_channel);
     }
 
-    m_demuxers.clear();
-    delete m_queue;
-
-    m_uid = 0;
     delete m_streamPacket;
 
+    for(auto p: m_pendingPackets) {
+        delete p;
+    }
+
     isyslog("live streamer terminated");
 }
 
@@ -87,202 +65,92 @@ void LiveStreamer::setWaitForKeyFrame(bool waitforiframe) {
     m_waitForKeyFrame = waitforiframe;
 }
 
-void LiveStreamer::onStreamChange() {
-    m_requestStreamChange = true;
-}
-
 int LiveStreamer::switchChannel(const cChannel* channel) {
     if(channel == nullptr) {
         esyslog("unknown channel !");
         return ROBOTV_RET_ERROR;
     }
 
-    // get device for this channel
-    cDevice* device = cDevice::GetDevice(channel, LIVEPRIORITY, false);
+    int status = ROBOTV_RET_ERROR;
+    m_channel = LiveChannel::attach(this, channel, m_priority, m_cacheEnabled, status);
 
-    // maybe an encrypted channel that cannot be handled
-    // lets try if a device can decrypt it on it's own (without a CAM slot)
-    if(device == nullptr) {
-        device = cDevice::GetDeviceForTransponder(channel, LIVEPRIORITY);
+    if(m_channel == nullptr) {
+        return status;
     }
 
-    // maybe all devices busy
-    if(device == nullptr) {
-        // return status "recording running" if there is an active timer
-        time_t now = time(nullptr);
+    // start with the last keyframe of a running channel
+    m_reader = m_channel->getQueue()->attachReader(m_waitForKeyFrame);
 
-        for(cTimer* ti = Timers.First(); ti; ti = Timers.Next(ti)) {
-            if(ti->Recording() && ti->Matches(now)) {
-                esyslog("Recording running !");
-                return ROBOTV_RET_RECRUNNING;
-            }
-        }
-
-        esyslog("No device available !");
-        return ROBOTV_RET_DATALOCKED;
+    // send the current stream information if the channel is already running
+    if(m_channel->isReady()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingPackets.push_back(m_channel->createStreamChangePacket(m_language.c_str(), m_langStreamType));
     }
 
-    isyslog("Found available device %d", device->DeviceNumber() + 1);
-
-    if(!device->SwitchChannel(channel, false)) {
-        esyslog("Can't switch to channel %i - %s", channel->Number(), channel->Name());
-        return ROBOTV_RET_ERROR;
+    if(m_waitForKeyFrame) {
+        isyslog("Will wait for first key frame ...");
     }
 
-    m_uid = createChannelUid(channel);
-
-    StreamBundle currentitem = createFromChannel(channel);
-    StreamBundle bundle;
-
-    // get cached demuxer data (if available & enabled)
-    if(m_cacheEnabled) {
-        ChannelCache &cache = ChannelCache::instance();
-        bundle = cache.lookup(m_uid);
-
-        // channel already in cache
-        if (bundle.size() != 0) {
-            isyslog("Channel information found in cache");
-        }
-        // channel not found in cache -> add it from vdr
-        else {
-            isyslog("adding channel to cache");
-            bundle = createFromChannel(channel);
-            cache.add(m_uid, bundle);
-        }
+    return ROBOTV_RET_OK;
+}
 
-        // recheck cache item
-        if (!currentitem.isMetaOf(bundle)) {
-            isyslog("current channel differs from cache item - updating");
-            bundle = createFromChannel(channel);
-            cache.add(m_uid, bundle);
-        }
-    }
-    // use current channel data
-    else {
-        bundle = currentitem;
-    }
+void LiveStreamer::park() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_parent = NULL;
+}
 
-    if(bundle.size() == 0) {
-        esyslog("channel %i - %s doesn't have any stream information", channel->Number(), channel->Name());
-        return false;
+int LiveStreamer::resume(RoboTvClient* parent) {
+    if(m_channel == nullptr) {
+        return ROBOTV_RET_ERROR;
     }
 
-    isyslog("Creating demuxers");
-    createDemuxers(&bundle);
-
-    onStreamChange();
-
-    isyslog("Successfully switched to channel %i - %s", channel->Number(), channel->Name());
-
-    if(m_waitForKeyFrame) {
-        isyslog("Will wait for first key frame ...");
-    }
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-    // fool device to not start the decryption timer
-    int priority = Priority();
-    SetPriority(MINPRIORITY);
+    m_parent = parent;
 
-    /// attach receiver
-    if (device->AttachReceiver(this) == false) {
-        esyslog("failed to attach receiver !");
-        return false;
+    // the new client side decoder needs the stream setup and a keyframe to start
+    for(auto p: m_pendingPackets) {
+        delete p;
     }
 
-    // start decrypting manually
-    cCamSlot* slot = device->CamSlot();
+    m_pendingPackets.clear();
 
-    if(slot) {
-        slot->StartDecrypting();
+    if(m_channel->isReady()) {
+        m_pendingPackets.push_back(m_channel->createStreamChangePacket(m_language.c_str(), m_langStreamType));
     }
 
-    SetPriority(priority);
+    m_waitForKeyFrame = true;
 
-    isyslog("done switching.");
     return ROBOTV_RET_OK;
 }
 
-void LiveStreamer::onStreamPacket(TsDemuxer::StreamPacket *pkt) {
-    // skip empty packets
-    if(pkt == nullptr || pkt->size == 0) {
-        return;
-    }
-
-    // skip non audio / video packets
-    if(!(pkt->content == StreamInfo::Content::AUDIO || pkt->content == StreamInfo::Content::VIDEO)) {
-        return;
-    }
-
-    // send stream change on demand
-    if(m_requestStreamChange && m_demuxers.isReady()) {
-        sendStreamChange();
-    }
+void LiveStreamer::sendDetach() {
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-    // wait for first I-Frame (if enabled)
-    if(m_waitForKeyFrame && pkt->frameType != StreamInfo::FrameType::IFRAME) {
+    // parked streamers don't have a client
+    if(m_parent == NULL) {
         return;
     }
 
-    m_waitForKeyFrame = false;
-
-    // initialise stream packet
-    MsgPacket* packet = new MsgPacket(ROBOTV_STREAM_MUXPKT, ROBOTV_CHANNEL_STREAM);
-    packet->disablePayloadCheckSum();
-
-    // write stream data
-    packet->put_U16(pkt->pid);
-    packet->put_S64(pkt->pts);
-    packet->put_S64(pkt->dts);
-    packet->put_U32(pkt->duration);
-
-    // write frame type into unused header field clientid
-    packet->setClientID((uint16_t)pkt->frameType);
-
-    // write payload into stream packet
-    packet->put_U32(pkt->size);
-    packet->put_Blob(pkt->data, pkt->size);
-
-    // add timestamp (wallclock time in ms)
-    packet->put_S64(roboTV::currentTimeMillis().count());
-
-    m_queue->queue(packet, pkt->content, pkt->pts);
-}
-
-void LiveStreamer::sendDetach() {
     isyslog("sending detach message");
     MsgPacket* resp = new MsgPacket(ROBOTV_STREAM_DETACH, ROBOTV_CHANNEL_STREAM);
     m_parent->queueMessage(resp);
 }
 
-void LiveStreamer::sendStreamChange() {
-    isyslog("stream change notification");
-
-    StreamBundle cache;
+void LiveStreamer::sendStatus(int status) {
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-    for(auto i = m_demuxers.begin(); i != m_demuxers.end(); i++) {
-        cache.addStream(*(*i));
+    if(m_parent == NULL) {
+        return;
     }
 
-    ChannelCache::instance().add(m_uid, cache);
-
-    // reorder streams as preferred
-    m_demuxers.reorderStreams(m_language.c_str(), m_langStreamType);
-
-    MsgPacket* resp = createStreamChangePacket(m_demuxers);
-    m_queue->queue(resp, StreamInfo::Content::STREAMINFO);
-
-    m_requestStreamChange = false;
-}
-
-void LiveStreamer::sendStatus(int status) {
     MsgPacket* packet = new MsgPacket(ROBOTV_STREAM_STATUS, ROBOTV_CHANNEL_STREAM);
     packet->put_U32(status);
     m_parent->queueMessage(packet);
 }
 
-void LiveStreamer::requestSignalInfo() {
-    cDevice* device = Device();
-
-    if(device == nullptr || !IsAttached()) {
+void LiveStreamer::requestSignalInfo(bool streamStats) {
+    if(m_channel == nullptr) {
         return;
     }
 
@@ -292,64 +160,25 @@ void LiveStreamer::requestSignalInfo() {
         return;
     }
 
-    MsgPacket* resp = new MsgPacket(ROBOTV_STREAM_SIGNALINFO, ROBOTV_CHANNEL_STREAM);
+    MsgPacket* resp = m_channel->createSignalInfoPacket(streamStats);
 
-    int DeviceNumber = device->DeviceNumber() + 1;
-    int Strength = 0;
-    int Quality = 0;
-
-    Strength = device->SignalStrength();
-    Quality = device->SignalQuality();
-
-    resp->put_String(*cString::sprintf(
-                         "%s #%d - %s",
-                         (const char*)device->DeviceType(),
-                         DeviceNumber,
-                         (const char*)device->DeviceName()));
-
-    // Quality:
-    // 4 - NO LOCK
-    // 3 - NO SYNC
-    // 2 - NO VITERBI
-    // 1 - NO CARRIER
-    // 0 - NO SIGNAL
-
-    if(Quality == -1) {
-        resp->put_String("UNKNOWN (Incompatible device)");
-        Quality = 0;
-    }
-    else {
-        resp->put_String(*cString::sprintf("%s:%s:%s:%s:%s",
-                                           (Quality > 4) ? "LOCKED" : "-",
-                                           (Quality > 0) ? "SIGNAL" : "-",
-                                           (Quality > 1) ? "CARRIER" : "-",
-                                           (Quality > 2) ? "VITERBI" : "-",
-                                           (Quality > 3) ? "SYNC" : "-"));
+    if(resp == nullptr) {
+        return;
     }
 
-    resp->put_U32((Strength << 16) / 100);
-    resp->put_U32((Quality << 16) / 100);
-    resp->put_U32(0);
-    resp->put_U32(0);
-
-    // get provider & service information
-    const cChannel* channel = findChannelByUid(m_uid);
+    dsyslog("RequestSignalInfo");
 
-    if(channel != nullptr) {
-        // put in provider name
-        resp->put_String(channel->Provider());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pendingPackets.push_back(resp);
+}
 
-        // what the heck should be the service name ?
-        // using PortalName for now
-        resp->put_String(channel->PortalName());
-    }
-    else {
-        resp->put_String("");
-        resp->put_String("");
+bool LiveStreamer::putStreamStats(MsgPacket* p) {
+    if(m_channel == nullptr) {
+        return false;
     }
 
-    dsyslog("RequestSignalInfo");
-    m_queue->queue(resp, StreamInfo::Content::NONE);
+    m_channel->putStreamStats(p);
+    return true;
 }
 
 void LiveStreamer::setLanguage(const char* lang, StreamInfo::Type streamtype) {
@@ -362,47 +191,81 @@ void LiveStreamer::setLanguage(const char* lang, StreamInfo::Type streamtype) {
 }
 
 bool LiveStreamer::isPaused() {
-    if(m_queue == nullptr) {
+    if(m_channel == nullptr) {
         return false;
     }
 
-    return m_queue->isPaused();
+    return m_channel->getQueue()->isPaused(m_reader);
 }
 
 void LiveStreamer::pause(bool on) {
-    if(m_queue == nullptr) {
+    if(m_channel == nullptr) {
         return;
     }
 
-    m_queue->pause(on);
+    m_channel->getQueue()->pause(m_reader, on);
+}
+
+std::shared_ptr<MsgPacket> LiveStreamer::nextPacket(bool keyFrameMode) {
+    // out of band packets first
+    if(!m_pendingPackets.empty()) {
+        std::shared_ptr<MsgPacket> p(m_pendingPackets.front());
+        m_pendingPackets.pop_front();
+        return p;
+    }
+
+    std::shared_ptr<MsgPacket> p;
+
+    while((p = m_channel->getQueue()->read(m_reader, keyFrameMode)) != nullptr) {
+
+        // replace stream change with our preferred stream order
+        if(p->getMsgID() == ROBOTV_STREAM_CHANGE) {
+            return std::shared_ptr<MsgPacket>(m_channel->createStreamChangePacket(m_language.c_str(), m_langStreamType));
+        }
+
+        // wait for first I-Frame (if enabled)
+        if(m_waitForKeyFrame && p->getMsgID() == ROBOTV_STREAM_MUXPKT) {
+            if(p->getClientID() != (uint16_t)StreamInfo::FrameType::IFRAME) {
+                continue;
+            }
+
+            m_waitForKeyFrame = false;
+        }
+
+        return p;
+    }
+
+    return nullptr;
 }
 
-MsgPacket* LiveStreamer::requestPacket(bool keyFrameMode) {
+MsgPacket* LiveStreamer::requestPacket(bool keyFrameMode, bool flush) {
     std::lock_guard<std::mutex> lock(m_mutex);
 
+    if(m_channel == nullptr) {
+        return nullptr;
+    }
+
+    LiveQueue* queue = m_channel->getQueue();
+
     // create payload packet
     if(m_streamPacket == nullptr) {
         m_streamPacket = new MsgPacket();
-        m_streamPacket->put_S64(m_queue->getTimeshiftStartPosition());
+        m_streamPacket->put_S64(queue->getTimeshiftStartPosition());
         m_streamPacket->put_S64(roboTV::currentTimeMillis().count());
         m_streamPacket->disablePayloadCheckSum();
     }
 
     // request packet from queue
-    MsgPacket* p = nullptr;
+    std::shared_ptr<MsgPacket> p;
 
-    while((p = m_queue->read(keyFrameMode)) != nullptr) {
+    while((p = nextPacket(keyFrameMode)) != nullptr) {
 
         // add data
         m_streamPacket->put_U16(p->getMsgID());
         m_streamPacket->put_U16(p->getClientID());
 
-        // add payload
-        uint8_t* data = p->getPayload();
-        int length = p->getPayloadLength();
-        m_streamPacket->put_Blob(data, length);
-
-        delete p;
+        // reference payload (no copy)
+        m_streamPacket->put_Reference(p, p->getPayload(), p->getPayloadLength());
 
         // send payload packet if it's big enough
         if(m_streamPacket->getPayloadLength() >= MIN_PACKET_SIZE) {
@@ -412,7 +275,11 @@ MsgPacket* LiveStreamer::requestPacket(bool keyFrameMode) {
         }
     }
 
-    if(m_queue->isPaused()) {
+    // flush: return everything available (but never an empty packet)
+    // otherwise: return the remaining data if paused
+    bool ready = flush ? (m_streamPacket->getPayloadLength() > 2 * sizeof(int64_t)) : queue->isPaused(m_reader);
+
+    if(ready) {
         MsgPacket* result = m_streamPacket;
         m_streamPacket = nullptr;
         return result;
@@ -421,36 +288,9 @@ MsgPacket* LiveStreamer::requestPacket(bool keyFrameMode) {
     return nullptr;
 }
 
-#if VDRVERSNUM < 20300
-void LiveStreamer::Receive(uchar* Data, int Length)
-#else
-void LiveStreamer::Receive(const uchar* Data, int Length)
-#endif
-{
-    m_demuxers.processTsPacket(Data);
-}
-
 void LiveStreamer::processChannelChange(const cChannel* channel) {
-    if(createChannelUid(channel) != m_uid) {
-        return;
-    }
-
-    isyslog("ChannelChange()");
-
-    Detach();
-    switchChannel(channel);
-}
-
-void LiveStreamer::createDemuxers(StreamBundle* bundle) {
-    // update demuxers
-    m_demuxers.updateFrom(bundle);
-
-    // update pids
-    SetPids(nullptr);
-
-    for(auto i = m_demuxers.begin(); i != m_demuxers.end(); i++) {
-        TsDemuxer* dmx = *i;
-        AddPid(dmx->getPid());
+    if(m_channel != nullptr) {
+        m_channel->processChannelChange(channel);
     }
 }
 
@@ -461,66 +301,20 @@ int64_t LiveStreamer::seek(int64_t wallclockPositionMs) {
     delete m_streamPacket;
     m_streamPacket = nullptr;
 
-    // seek
-    return m_queue->seek(wallclockPositionMs);
-}
-
-StreamBundle LiveStreamer::createFromChannel(const cChannel* channel) {
-    StreamBundle item;
-
-    // add video stream
-    int vpid = channel->Vpid();
-    int vtype = channel->Vtype();
-
-    item.addStream(StreamInfo(vpid,
-                              vtype == 0x02 ? StreamInfo::Type::MPEG2VIDEO :
-                              vtype == 0x1b ? StreamInfo::Type::H264 :
-                              vtype == 0x24 ? StreamInfo::Type::H265 :
-                              StreamInfo::Type::NONE));
-
-    // add (E)AC3 streams
-    for(int i = 0; channel->Dpid(i) != 0; i++) {
-        int dtype = channel->Dtype(i);
-        item.addStream(StreamInfo(channel->Dpid(i),
-                                  dtype == 0x6A ? StreamInfo::Type::AC3 :
-                                  dtype == 0x7A ? StreamInfo::Type::EAC3 :
-                                  StreamInfo::Type::NONE,
-                                  channel->Dlang(i)));
+    if(m_channel == nullptr) {
+        return 0;
     }
 
-    // add audio streams
-    for(int i = 0; channel->Apid(i) != 0; i++) {
-        int atype = channel->Atype(i);
-        item.addStream(StreamInfo(channel->Apid(i),
-                                  atype == 0x04 ? StreamInfo::Type::MPEG2AUDIO :
-                                  atype == 0x03 ? StreamInfo::Type::MPEG2AUDIO :
-                                  atype == 0x0f ? StreamInfo::Type::AAC :
-                                  atype == 0x11 ? StreamInfo::Type::LATM :
-                                  StreamInfo::Type::NONE,
-                                  channel->Alang(i)));
-    }
-
-    // add subtitle streams
-    for(int i = 0; channel->Spid(i) != 0; i++) {
-        StreamInfo stream(channel->Spid(i), StreamInfo::Type::DVBSUB, channel->Slang(i));
-
-        stream.setSubtitlingDescriptor(
-                channel->SubtitlingType(i),
-                channel->CompositionPageId(i),
-                channel->AncillaryPageId(i));
-
-        item.addStream(stream);
-    }
-
-    return item;
+    // seek
+    return m_channel->getQueue()->seek(m_reader, wallclockPositionMs);
 }
 
-MsgPacket *LiveStreamer::createStreamChangePacket(const DemuxerBundle &bundle) {
+MsgPacket* LiveStreamer::createStreamChangePacket(const std::list<TsDemuxer*>& streams) {
     MsgPacket* resp = new MsgPacket(ROBOTV_STREAM_CHANGE, ROBOTV_CHANNEL_STREAM);
 
-    resp->put_U8(bundle.size());
+    resp->put_U8(streams.size());
 
-    for(auto stream: bundle) {
+    for(auto stream: streams) {
         int streamId = stream->getPid();
         resp->put_U32(streamId);
 
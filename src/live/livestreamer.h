@@ -26,46 +26,41 @@
 #define ROBOTV_RECEIVER_H
 
 #include <vdr/channels.h>
-#include <vdr/device.h>
-#include <vdr/receiver.h>
-#include <vdr/ringbuffer.h>
 
 #include "robotvdmx/demuxer.h"
-#include "robotvdmx/streambundle.h"
-#include "robotvdmx/demuxerbundle.h"
 #include "robotv/robotvcommand.h"
+#include "livequeue.h"
 
+#include <deque>
 #include <list>
+#include <memory>
 #include <mutex>
 
 class cChannel;
-class TsDemuxer;
 class MsgPacket;
-class LiveQueue;
+class LiveChannel;
 class RoboTvClient;
 
-class LiveStreamer : public cReceiver, public TsDemuxer::Listener {
+class LiveStreamer {
 private:
 
-    void sendStreamChange();
-
     void sendStatus(int status);
 
     void sendDetach();
 
-    DemuxerBundle m_demuxers = NULL;
+    std::shared_ptr<MsgPacket> nextPacket(bool keyFrameMode);
 
-    LiveQueue* m_queue = NULL;
+    LiveChannel* m_channel = NULL;
 
-    RoboTvClient* m_parent = NULL;
+    LiveQueue::Reader* m_reader = NULL;
 
-    bool m_requestStreamChange = false;
+    RoboTvClient* m_parent = NULL;
 
     std::string m_language;
 
     StreamInfo::Type m_langStreamType = StreamInfo::Type::AC3;
 
-    uint32_t m_uid;
+    int m_priority;
 
     bool m_waitForKeyFrame = false;
 
@@ -73,21 +68,9 @@ private:
 
     MsgPacket* m_streamPacket = NULL;
 
-    bool m_cacheEnabled;
-
-protected:
-
-#if VDRVERSNUM < 20300
-    void Receive(uchar* Data, int Length);
-#else
-    void Receive(const uchar* Data, int Length);
-#endif
-
-private:
-
-    StreamBundle createFromChannel(const cChannel* channel);
+    std::deque<MsgPacket*> m_pendingPackets;
 
-    void createDemuxers(StreamBundle* bundle);
+    bool m_cacheEnabled;
 
 public:
 
@@ -105,21 +88,24 @@ public:
 
     void pause(bool on);
 
-    MsgPacket* requestPacket(bool keyFrameMode = false);
+    MsgPacket* requestPacket(bool keyFrameMode = false, bool flush = false);
 
-    void requestSignalInfo();
+    // stream statistics are appended for protocol version 12 clients
+    void requestSignalInfo(bool streamStats);
 
-    int switchChannel(const cChannel* channel);
+    bool putStreamStats(MsgPacket* p);
 
-    int64_t seek(int64_t wallclockPositionMs);
+    int switchChannel(const cChannel* channel);
 
-    static MsgPacket* createStreamChangePacket(const DemuxerBundle& bundle);
+    // detach from the client connection, the streamer is kept in a timeshift session
+    void park();
 
-    // TsDemuxer::Listener implementation
+    // reattach a parked streamer to a (new) client connection
+    int resume(RoboTvClient* parent);
 
-    void onStreamPacket(TsDemuxer::StreamPacket *pkt);
+    int64_t seek(int64_t wallclockPositionMs);
 
-    void onStreamChange();
+    static MsgPacket* createStreamChangePacket(const std::list<TsDemuxer*>& streams);
 
 };
 
@@ -0,0 +1,76 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "timeshiftmemorytier.h"
+#include "net/msgpacket.h"
+
+#include <algorithm>
+
+TimeShiftMemoryTier::~TimeShiftMemoryTier() {
+    clear();
+}
+
+void TimeShiftMemoryTier::push(off_t position, int wrapCount, MsgPacket* p) {
+    p->freeze();
+    m_entries.push_back({position, wrapCount, std::shared_ptr<MsgPacket>(p)});
+    m_bytes += p->getPacketLength();
+}
+
+const TimeShiftMemoryTier::Entry& TimeShiftMemoryTier::front() const {
+    return m_entries.front();
+}
+
+TimeShiftMemoryTier::Entry TimeShiftMemoryTier::pop() {
+    Entry e = m_entries.front();
+    m_entries.pop_front();
+
+    m_bytes -= e.packet->getPacketLength();
+    return e;
+}
+
+std::shared_ptr<MsgPacket> TimeShiftMemoryTier::read(off_t position, int wrapCount) const {
+    auto i = std::lower_bound(m_entries.begin(), m_entries.end(), Entry{position, wrapCount, nullptr}, [](const Entry& a, const Entry& b) {
+        return (a.wrapCount < b.wrapCount) || (a.wrapCount == b.wrapCount && a.position < b.position);
+    });
+
+    if(i == m_entries.end() || i->wrapCount != wrapCount || i->position != position) {
+        return nullptr;
+    }
+
+    // packets are frozen and never modified once they are in the queue
+    return i->packet;
+}
+
+void TimeShiftMemoryTier::clear() {
+    m_entries.clear();
+    m_bytes = 0;
+}
+
+bool TimeShiftMemoryTier::empty() const {
+    return m_entries.empty();
+}
+
+uint64_t TimeShiftMemoryTier::bytes() const {
+    return m_bytes;
+}
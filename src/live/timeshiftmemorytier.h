@@ -0,0 +1,80 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_TIMESHIFTMEMORYTIER_H
+#define ROBOTV_TIMESHIFTMEMORYTIER_H
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <deque>
+#include <memory>
+
+class MsgPacket;
+
+/**
+ * In-memory tier of the timeshift ringbuffer.
+ *
+ * Holds the most recently written packets (ordered by buffer lap and
+ * position) so readers close to the live position are served without
+ * any disk i/o. The oldest packets are handed back to the queue for
+ * spilling to (or dropping from) the disk tier.
+ */
+
+class TimeShiftMemoryTier {
+public:
+
+    struct Entry {
+        off_t position;
+        int wrapCount;
+        std::shared_ptr<MsgPacket> packet;
+    };
+
+    ~TimeShiftMemoryTier();
+
+    // takes ownership of the packet
+    void push(off_t position, int wrapCount, MsgPacket* p);
+
+    const Entry& front() const;
+
+    // remove the oldest entry
+    Entry pop();
+
+    // shared packet at the position or nullptr if not in memory
+    std::shared_ptr<MsgPacket> read(off_t position, int wrapCount) const;
+
+    void clear();
+
+    bool empty() const;
+
+    uint64_t bytes() const;
+
+private:
+
+    std::deque<Entry> m_entries;
+
+    uint64_t m_bytes = 0;
+
+};
+
+#endif // ROBOTV_TIMESHIFTMEMORYTIER_H
@@ -0,0 +1,60 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_TIMESHIFTSTORAGE_H
+#define ROBOTV_TIMESHIFTSTORAGE_H
+
+#include <sys/types.h>
+
+class MsgPacket;
+
+class TimeShiftStorage {
+public:
+
+    enum class Type {
+        FILE,
+        MMAP
+    };
+
+    virtual ~TimeShiftStorage() = default;
+
+    static TimeShiftStorage* create(Type type);
+
+    static const char* typeName(Type type);
+
+    virtual bool open(const char* filename, off_t length) = 0;
+
+    virtual void close() = 0;
+
+    // write a (frozen) packet at the given position
+    virtual bool write(off_t position, MsgPacket* p) = 0;
+
+    // read the packet stored at the given position (NULL if there isn't one)
+    virtual MsgPacket* read(off_t position) = 0;
+
+    virtual void sync() = 0;
+
+};
+
+#endif // ROBOTV_TIMESHIFTSTORAGE_H
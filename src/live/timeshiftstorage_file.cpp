@@ -0,0 +1,127 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include <vdr/tools.h>
+
+#include "net/msgpacket.h"
+#include "timeshiftstorage_file.h"
+
+TimeShiftFileStorage::TimeShiftFileStorage() : m_readFd(-1), m_writeFd(-1), m_readPosition(0), m_writePosition(0) {
+}
+
+TimeShiftFileStorage::~TimeShiftFileStorage() {
+    close();
+}
+
+bool TimeShiftFileStorage::open(const char* filename, off_t length) {
+    m_writeFd = ::open(filename, O_CREAT | O_WRONLY, 0644);
+
+    if(m_writeFd == -1) {
+        esyslog("Failed to create timeshift ringbuffer !");
+        return false;
+    }
+
+    int rc = posix_fallocate(m_writeFd, 0, length);
+
+    if(rc != 0) {
+        dsyslog("unable to pre-allocate %li bytes for timeshift ringbuffer", length);
+        dsyslog("ERROR: %s (status = %i)", strerror(rc), rc);
+    }
+
+    m_readFd = ::open(filename, O_NOATIME | O_RDONLY, 0644);
+
+    if(m_readFd == -1) {
+        esyslog("Failed to create timeshift ringbuffer !");
+        return false;
+    }
+
+    posix_fadvise(m_readFd, 0, length, POSIX_FADV_SEQUENTIAL);
+
+    m_readPosition = lseek(m_readFd, 0, SEEK_SET);
+    m_writePosition = lseek(m_writeFd, 0, SEEK_SET);
+
+    return true;
+}
+
+void TimeShiftFileStorage::close() {
+    if(m_readFd != -1) {
+        ::close(m_readFd);
+        m_readFd = -1;
+    }
+
+    if(m_writeFd != -1) {
+        ::close(m_writeFd);
+        m_writeFd = -1;
+    }
+}
+
+bool TimeShiftFileStorage::write(off_t position, MsgPacket* p) {
+    // only seek if the position doesn't follow the last packet
+    if(position != m_writePosition) {
+        m_writePosition = lseek(m_writeFd, position, SEEK_SET);
+    }
+
+    if(m_writePosition != position) {
+        return false;
+    }
+
+    if(!p->write(m_writeFd, 1000)) {
+        m_writePosition = -1;
+        return false;
+    }
+
+    m_writePosition += p->getPacketLength();
+    return true;
+}
+
+MsgPacket* TimeShiftFileStorage::read(off_t position) {
+    if(position != m_readPosition) {
+        m_readPosition = lseek(m_readFd, position, SEEK_SET);
+    }
+
+    if(m_readPosition != position) {
+        return nullptr;
+    }
+
+    MsgPacket* p = MsgPacket::read(m_readFd, 1000);
+
+    // we don't know where we are after a failed read
+    if(p == nullptr) {
+        m_readPosition = -1;
+        return nullptr;
+    }
+
+    m_readPosition += p->getPacketLength();
+    return p;
+}
+
+void TimeShiftFileStorage::sync() {
+    if(fdatasync(m_writeFd) != 0) {
+        esyslog("Failed to sync timeshift ring-buffer !");
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_TIMESHIFTSTORAGE_FILE_H
+#define ROBOTV_TIMESHIFTSTORAGE_FILE_H
+
+#include "timeshiftstorage.h"
+
+class TimeShiftFileStorage : public TimeShiftStorage {
+public:
+
+    TimeShiftFileStorage();
+
+    virtual ~TimeShiftFileStorage();
+
+    bool open(const char* filename, off_t length);
+
+    void close();
+
+    bool write(off_t position, MsgPacket* p);
+
+    MsgPacket* read(off_t position);
+
+    void sync();
+
+private:
+
+    int m_readFd;
+
+    int m_writeFd;
+
+    off_t m_readPosition;
+
+    off_t m_writePosition;
+
+};
+
+#endif // ROBOTV_TIMESHIFTSTORAGE_FILE_H
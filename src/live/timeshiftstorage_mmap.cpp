@@ -0,0 +1,118 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <vdr/tools.h>
+
+#include "net/msgpacket.h"
+#include "timeshiftstorage_mmap.h"
+
+TimeShiftMmapStorage::TimeShiftMmapStorage() : m_fd(-1), m_data(nullptr), m_length(0) {
+}
+
+TimeShiftMmapStorage::~TimeShiftMmapStorage() {
+    close();
+}
+
+bool TimeShiftMmapStorage::open(const char* filename, off_t length) {
+    m_fd = ::open(filename, O_CREAT | O_RDWR | O_NOATIME, 0644);
+
+    if(m_fd == -1) {
+        esyslog("Failed to create timeshift ringbuffer !");
+        return false;
+    }
+
+    // the mapping must be backed by the file, otherwise we get SIGBUS
+    // when touching pages beyond the end of the file
+    int rc = posix_fallocate(m_fd, 0, length);
+
+    if(rc != 0) {
+        esyslog("unable to pre-allocate %li bytes for timeshift ringbuffer", length);
+        esyslog("ERROR: %s (status = %i)", strerror(rc), rc);
+        close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+
+    if(data == MAP_FAILED) {
+        esyslog("Failed to map timeshift ringbuffer (%s)", strerror(errno));
+        close();
+        return false;
+    }
+
+    m_data = (uint8_t*)data;
+    m_length = length;
+
+    madvise(m_data, m_length, MADV_SEQUENTIAL);
+    return true;
+}
+
+void TimeShiftMmapStorage::close() {
+    if(m_data != nullptr) {
+        munmap(m_data, m_length);
+        m_data = nullptr;
+        m_length = 0;
+    }
+
+    if(m_fd != -1) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool TimeShiftMmapStorage::write(off_t position, MsgPacket* p) {
+    if(m_data == nullptr) {
+        return false;
+    }
+
+    p->freeze();
+    uint32_t length = p->getPacketLength();
+
+    if(position < 0 || position + (off_t)length > m_length) {
+        esyslog("timeshift packet (%u bytes) exceeds mapped ringbuffer", length);
+        return false;
+    }
+
+    memcpy(m_data + position, p->getPacket(), length);
+    return true;
+}
+
+MsgPacket* TimeShiftMmapStorage::read(off_t position) {
+    if(m_data == nullptr || position < 0 || position >= m_length) {
+        return nullptr;
+    }
+
+    return MsgPacket::readbuffer(m_data + position, m_length - position);
+}
+
+void TimeShiftMmapStorage::sync() {
+    if(m_data != nullptr && msync(m_data, m_length, MS_ASYNC) != 0) {
+        esyslog("Failed to sync timeshift ring-buffer !");
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/**
+ * crc32 microbenchmark
+ *
+ * measures the throughput (MB/s) of all CRC-32 implementations for
+ * typical message sizes and verifies that they produce identical results.
+ *
+ * usage: robotv-crc32-benchmark [-i iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "net/crc32.h"
+
+// keeps the compiler from dropping the benchmark loops
+static volatile uint32_t sink;
+
+typedef uint32_t (*Engine)(uint32_t, const uint8_t*, size_t);
+
+static uint32_t clmul(uint32_t crc, const uint8_t* buf, size_t size) {
+    crc32UpdateClmul(crc, buf, size);
+    return crc;
+}
+
+static double measure(Engine engine, const uint8_t* buf, size_t size, size_t total, uint32_t& result) {
+    size_t rounds = std::max((size_t)1, total / size);
+    uint32_t crc = 0xFFFFFFFF;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for(size_t i = 0; i < rounds; i++) {
+        crc = engine(crc, buf, size);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    sink = crc;
+    result = engine(0xFFFFFFFF, buf, size);
+
+    return (double)(rounds * size) / seconds / (1024 * 1024);
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = 256;
+    int c;
+
+    while((c = getopt(argc, argv, "i:")) != -1) {
+        switch(c) {
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-i iterations]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    uint32_t probe = 0;
+    bool haveClmul = crc32UpdateClmul(probe, NULL, 0);
+
+    std::vector<uint8_t> data(1024 * 1024);
+
+    for(size_t i = 0; i < data.size(); i++) {
+        data[i] = (uint8_t)rand();
+    }
+
+    const size_t sizes[] = { 16, 64, 256, 1024, 4096, 65536, 1024 * 1024 };
+    const size_t total = (size_t)iterations * 1024 * 1024;
+    int errors = 0;
+
+    printf("%-10s %12s %12s %12s\n", "size", "bytewise", "slice-by-8", haveClmul ? "pclmul" : "pclmul (n/a)");
+
+    for(size_t size : sizes) {
+        uint32_t r1 = 0, r2 = 0, r3 = 0;
+
+        double bytewise = measure(crc32UpdateBytewise, data.data(), size, total / 8, r1);
+        double slice8 = measure(crc32UpdateSlice8, data.data(), size, total, r2);
+        double folded = haveClmul ? measure(clmul, data.data(), size, total, r3) : 0;
+
+        if(r1 != r2 || (haveClmul && r1 != r3)) {
+            fprintf(stderr, "checksum mismatch at %zu bytes\n", size);
+            errors++;
+        }
+
+        printf("%-10zu %12.1f %12.1f %12.1f\n", size, bytewise, slice8, folded);
+    }
+
+    return errors ? 1 : 0;
+}
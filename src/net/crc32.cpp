@@ -0,0 +1,244 @@
+#include <string.h>
+
+#include "crc32.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CRC32_X86
+#include <immintrin.h>
+#endif
+
+// reflected polynomial
+#define CRC32_POLY 0xEDB88320
+
+// the folding code needs at least one block of 64 bytes
+#define CRC32_CLMUL_MIN 64
+
+typedef uint32_t (*Crc32Engine)(uint32_t, const uint8_t*, size_t);
+
+struct Crc32Tables {
+    uint32_t t[8][256];
+
+    Crc32Tables() {
+        for(uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+
+            for(int k = 0; k < 8; k++) {
+                c = (c & 1) ? (c >> 1) ^ CRC32_POLY : (c >> 1);
+            }
+
+            t[0][i] = c;
+        }
+
+        for(int i = 0; i < 256; i++) {
+            for(int s = 1; s < 8; s++) {
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+static const Crc32Tables tables;
+
+uint32_t crc32UpdateBytewise(uint32_t crc, const uint8_t* buf, size_t size) {
+    while(size--) {
+        crc = tables.t[0][(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+uint32_t crc32UpdateSlice8(uint32_t crc, const uint8_t* buf, size_t size) {
+    // align to 4 bytes
+    while(size > 0 && ((uintptr_t)buf & 3) != 0) {
+        crc = tables.t[0][(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+        size--;
+    }
+
+    while(size >= 8) {
+        uint32_t one;
+        uint32_t two;
+        memcpy(&one, buf, 4);
+        memcpy(&two, buf + 4, 4);
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        one = __builtin_bswap32(one);
+        two = __builtin_bswap32(two);
+#endif
+
+        one ^= crc;
+
+        crc = tables.t[7][one & 0xFF] ^
+              tables.t[6][(one >> 8) & 0xFF] ^
+              tables.t[5][(one >> 16) & 0xFF] ^
+              tables.t[4][one >> 24] ^
+              tables.t[3][two & 0xFF] ^
+              tables.t[2][(two >> 8) & 0xFF] ^
+              tables.t[1][(two >> 16) & 0xFF] ^
+              tables.t[0][two >> 24];
+
+        buf += 8;
+        size -= 8;
+    }
+
+    return crc32UpdateBytewise(crc, buf, size);
+}
+
+#ifdef CRC32_X86
+
+// folding constants for the reflected polynomial (Intel, "Fast CRC Computation
+// for Generic Polynomials Using PCLMULQDQ Instruction")
+alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+alignas(16) static const uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+alignas(16) static const uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+// size must be a multiple of 16 and at least 64 bytes
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32Fold(uint32_t crc, const uint8_t* buf, size_t size) {
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+    x0 = _mm_load_si128((const __m128i*)k1k2);
+
+    buf += 64;
+    size -= 64;
+
+    // fold 4 x 128 bits in parallel
+    while(size >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+        buf += 64;
+        size -= 64;
+    }
+
+    // fold into 128 bits
+    x0 = _mm_load_si128((const __m128i*)k3k4);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // remaining blocks of 16 bytes
+    while(size >= 16) {
+        x2 = _mm_loadu_si128((const __m128i*)buf);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        buf += 16;
+        size -= 16;
+    }
+
+    // fold 128 to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // barrett reduction to 32 bits
+    x0 = _mm_load_si128((const __m128i*)poly);
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32UpdateFold(uint32_t crc, const uint8_t* buf, size_t size) {
+    if(size < CRC32_CLMUL_MIN) {
+        return crc32UpdateSlice8(crc, buf, size);
+    }
+
+    size_t blocks = size & ~(size_t)15;
+    crc = crc32Fold(crc, buf, blocks);
+
+    return crc32UpdateSlice8(crc, buf + blocks, size - blocks);
+}
+
+static bool clmulSupported() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+
+#else
+
+static bool clmulSupported() {
+    return false;
+}
+
+#endif // CRC32_X86
+
+static const bool haveClmul = clmulSupported();
+
+static Crc32Engine selectEngine() {
+#ifdef CRC32_X86
+    if(haveClmul) {
+        return crc32UpdateFold;
+    }
+#endif
+
+    return crc32UpdateSlice8;
+}
+
+static const Crc32Engine engine = selectEngine();
+
+bool crc32UpdateClmul(uint32_t& crc, const uint8_t* buf, size_t size) {
+#ifdef CRC32_X86
+    if(haveClmul) {
+        crc = crc32UpdateFold(crc, buf, size);
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* buf, size_t size) {
+    return engine(crc, buf, size);
+}
+
+uint32_t crc32Buffer(const uint8_t* buf, size_t size) {
+    return crc32Update(0xFFFFFFFF, buf, size) ^ ~0U;
+}
@@ -0,0 +1,27 @@
+/** \file crc32.h
+	CRC-32 (IEEE 802.3) engine shared by MsgPacket and the channel / timer hashes.
+	The fastest implementation (PCLMULQDQ / slice-by-8) is selected at runtime,
+	all implementations produce identical results.
+*/
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// update a running crc (start with 0xFFFFFFFF, invert the final value)
+uint32_t crc32Update(uint32_t crc, const uint8_t* buf, size_t size);
+
+// checksum of a complete buffer
+uint32_t crc32Buffer(const uint8_t* buf, size_t size);
+
+// single implementations (benchmark)
+uint32_t crc32UpdateBytewise(uint32_t crc, const uint8_t* buf, size_t size);
+
+uint32_t crc32UpdateSlice8(uint32_t crc, const uint8_t* buf, size_t size);
+
+// returns false if the cpu doesn't support PCLMULQDQ
+bool crc32UpdateClmul(uint32_t& crc, const uint8_t* buf, size_t size);
+
+#endif // CRC32_H
@@ -6,14 +6,26 @@
 #include <zlib.h>
 #endif
 
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <iostream>
 #include <unistd.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <limits.h>
 
 #include "os-config.h"
 #include "msgpacket.h"
+#include "crc32.h"
 
 #define get_impl(T, f) \
 	if((m_readposition + sizeof(T)) > m_usage) { \
@@ -35,53 +47,6 @@ pthread_mutex_t MsgPacket::uidmutex = PTHREAD_MUTEX_INITIALIZER;
 
 uint32_t MsgPacket::globalUID = 1;
 
-uint32_t MsgPacket::crc32_tab[] = {
-    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-    0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-    0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-    0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-    0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-    0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
-    0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-    0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-    0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
-    0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-    0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-    0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-    0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-    0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-    0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-    0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-    0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-    0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-    0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-    0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-    0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-    0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-    0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-    0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-    0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-    0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-    0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-    0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-    0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-    0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-    0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-    0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-};
-
-
 MsgPacket::MsgPacket() : m_packet(NULL), m_size(InitialPacketSize), m_usage(HeaderLength), m_readposition(HeaderLength), m_freezed(false), m_payloadchecksum(true) {
     Init(0, 0, 0);
 }
@@ -196,7 +161,35 @@ bool MsgPacket::put_Blob(uint8_t source[], uint32_t length) {
     return true;
 }
 
+bool MsgPacket::put_Reference(const std::shared_ptr<MsgPacket>& source, uint8_t* data, uint32_t length) {
+    if(length == 0) {
+        return true;
+    }
+
+    m_references.push_back({m_usage, source, data, length});
+    m_referenceLength += length;
+
+    return true;
+}
+
+bool MsgPacket::put_Payload(MsgPacket* source) {
+    uint32_t position = HeaderLength;
+
+    for(auto& r: source->m_references) {
+        if(!put_Blob(source->m_packet + position, r.position - position)) {
+            return false;
+        }
+
+        put_Reference(r.source, r.data, r.length);
+        position = r.position;
+    }
+
+    return put_Blob(source->m_packet + position, source->m_usage - position);
+}
+
 void MsgPacket::clear() {
+    m_references.clear();
+    m_referenceLength = 0;
     m_usage = HeaderLength;
     m_readposition = HeaderLength;
 }
@@ -301,7 +294,7 @@ uint8_t* MsgPacket::getPacket() {
 }
 
 uint32_t MsgPacket::getPacketLength() {
-    return m_usage;
+    return m_usage + m_referenceLength;
 }
 
 uint8_t* MsgPacket::getPayload() {
@@ -309,7 +302,7 @@ uint8_t* MsgPacket::getPayload() {
 }
 
 uint32_t MsgPacket::getPayloadLength() {
-    return m_usage - HeaderLength;
+    return m_usage - HeaderLength + m_referenceLength;
 }
 
 uint32_t MsgPacket::getUID() {
@@ -356,11 +349,21 @@ void MsgPacket::freeze() {
     uint32_t payloadCheckSum = 0;
 
     if(getPayloadLength() > 0 && m_payloadchecksum) {
-        payloadCheckSum = crc32(m_packet + HeaderLength, m_usage - HeaderLength);
+        uint32_t crc = 0xFFFFFFFF;
+        uint32_t position = HeaderLength;
+
+        for(auto& r: m_references) {
+            crc = crc32Update(crc, m_packet + position, r.position - position);
+            crc = crc32Update(crc, r.data, r.length);
+            position = r.position;
+        }
+
+        crc = crc32Update(crc, m_packet + position, m_usage - position);
+        payloadCheckSum = (crc ^ ~0U);
     }
 
     writePacket<uint32_t>(PayloadCheckSumPos, htobe32(payloadCheckSum));
-    writePacket<uint32_t>(PayloadLengthPos, htobe32(m_usage - HeaderLength));
+    writePacket<uint32_t>(PayloadLengthPos, htobe32(getPayloadLength()));
     writePacket<uint32_t>(CheckSumPos, htobe32(crc32(m_packet, CheckSumPos)));
 
     m_freezed = true;
@@ -398,19 +401,20 @@ bool MsgPacket::checkPacketSize(uint32_t bytes) {
 }
 
 uint32_t MsgPacket::crc32(const uint8_t* buf, int size) {
-    uint32_t crc = 0xFFFFFFFF;
-    const uint8_t* p = buf;
-
-    while(size--) {
-        crc = crc32_tab[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
-    }
+    return crc32Buffer(buf, size);
+}
 
-    return (crc ^ ~0U);
+uint32_t MsgPacket::crc32Update(uint32_t crc, const uint8_t* buf, int size) {
+    return ::crc32Update(crc, buf, size);
 }
 
 bool MsgPacket::write(int fd, int timeout_ms) {
     freeze();
 
+    if(!m_references.empty()) {
+        return writeReferences(fd, timeout_ms);
+    }
+
     uint32_t written = 0;
 
     while(written < m_usage) {
@@ -438,6 +442,74 @@ bool MsgPacket::write(int fd, int timeout_ms) {
     return true;
 }
 
+void MsgPacket::gather(std::vector<struct iovec>& iov) {
+    freeze();
+
+    // packet buffer and referenced data
+    uint32_t position = 0;
+
+    for(auto& r: m_references) {
+        if(r.position > position) {
+            iov.push_back({m_packet + position, r.position - position});
+        }
+
+        iov.push_back({r.data, r.length});
+        position = r.position;
+    }
+
+    if(m_usage > position) {
+        iov.push_back({m_packet + position, m_usage - position});
+    }
+}
+
+bool MsgPacket::writeReferences(int fd, int timeout_ms) {
+    std::vector<struct iovec> iov;
+    iov.reserve(m_references.size() * 2 + 1);
+
+    gather(iov);
+
+    size_t index = 0;
+
+    while(index < iov.size()) {
+        if(pollfd(fd, timeout_ms, false) == 0) {
+            return false;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov[index];
+        msg.msg_iovlen = std::min(iov.size() - index, (size_t)IOV_MAX);
+
+        ssize_t rc = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        if(rc == -1 && sockerror() == ENOTSOCK) {
+            rc = ::writev(fd, msg.msg_iov, msg.msg_iovlen);
+        }
+
+        if(rc == -1 || rc == 0) {
+            if(sockerror() == SEWOULDBLOCK) {
+                continue;
+            }
+
+            return false;
+        }
+
+        // skip completely written buffers
+        while(rc > 0) {
+            if((size_t)rc < iov[index].iov_len) {
+                iov[index].iov_base = (uint8_t*)iov[index].iov_base + rc;
+                iov[index].iov_len -= rc;
+                break;
+            }
+
+            rc -= iov[index].iov_len;
+            index++;
+        }
+    }
+
+    return true;
+}
+
 MsgPacket* MsgPacket::read(int fd, int timeout_ms) {
     bool bClosed;
     return read(fd, bClosed, timeout_ms);
@@ -531,6 +603,19 @@ MsgPacket* MsgPacket::read(int fd, bool& closed, int timeout_ms) {
     return p;
 }
 
+bool MsgPacket::writestream(std::ostream& out, MsgPacket& p) {
+    uint32_t position = 0;
+
+    for(auto& r: p.m_references) {
+        out.write((const char*)p.m_packet + position, r.position - position);
+        out.write((const char*)r.data, r.length);
+        position = r.position;
+    }
+
+    out.write((const char*)p.m_packet + position, p.m_usage - position);
+    return out.good();
+}
+
 bool MsgPacket::readstream(std::istream& in, MsgPacket& p) {
     uint8_t* header = p.getPacket();
 
@@ -609,12 +694,120 @@ bool MsgPacket::readstream(std::istream& in, MsgPacket& p) {
     return true;
 }
 
-bool MsgPacket::compress(int level) {
-#ifndef HAVE_ZLIB
+MsgPacket* MsgPacket::readbuffer(const uint8_t* data, size_t datalen) {
+    if(data == NULL || datalen < HeaderLength) {
+        return NULL;
+    }
+
+    MsgPacket* p = new MsgPacket(0, 0, 1);
+
+    if(!p->load(data, datalen)) {
+        delete p;
+        return NULL;
+    }
+
+    return p;
+}
+
+bool MsgPacket::load(const uint8_t* data, size_t datalen) {
+    if(data == NULL || datalen < HeaderLength || m_packet == NULL) {
+        return false;
+    }
+
+    clear();
+    m_freezed = false;
+    m_payloadchecksum = true;
+
+    uint8_t* header = getPacket();
+    memcpy(header, data, HeaderLength);
+
+    // check sync
+    if(be32toh(readPacket<uint32_t>(SyncPos)) != 0xAAAAAA) {
+        return false;
+    }
+
+    // header validation
+    if(getCheckSum() != crc32(header, CheckSumPos)) {
+        return false;
+    }
+
+    uint32_t payloadlen = be32toh(readPacket<uint32_t>(PayloadLengthPos));
+
+    if(payloadlen > datalen - HeaderLength) {
+        return false;
+    }
+
+    // no payload ?
+    if(payloadlen == 0) {
+        return true;
+    }
+
+    // copy payload
+    uint8_t* payload = reserve(payloadlen);
+
+    if(payload == NULL) {
+        return false;
+    }
+
+    memcpy(payload, data + HeaderLength, payloadlen);
+
+    // payload checksum validation
+    uint32_t plcs = getPayloadCheckSum();
+    m_payloadchecksum = (plcs != 0);
+
+    return !m_payloadchecksum || plcs == crc32(payload, payloadlen);
+}
+
+bool MsgPacket::codecAvailable(int codec) {
+    switch(codec) {
+#ifdef HAVE_ZLIB
+        case CodecZlib:
+            return true;
+#endif
+#ifdef HAVE_LZ4
+        case CodecLz4:
+            return true;
+#endif
+#ifdef HAVE_ZSTD
+        case CodecZstd:
+            return true;
+#endif
+    }
+
     return false;
-#else
+}
+
+int MsgPacket::maxCompressionLevel(int codec) {
+    switch(codec) {
+        case CodecZlib:
+            return 9;
+
+        case CodecLz4:
+            return 1;
+
+        case CodecZstd:
+            return 19;
+    }
+
+    return 0;
+}
 
-    if(level <= 0 || level > 9 || m_freezed) {
+void MsgPacket::setCompression(int codec, int level) {
+    m_compressionCodec = codec;
+    m_compressionLevel = level;
+}
+
+bool MsgPacket::compress() {
+    return compress(m_compressionLevel, m_compressionCodec);
+}
+
+bool MsgPacket::compress(int level, int codec) {
+    if(level <= 0 || level > maxCompressionLevel(codec) || !codecAvailable(codec) || m_freezed) {
+        return false;
+    }
+
+    // referenced data can't be compressed in place
+    if(!m_references.empty()) {
         return false;
     }
 
@@ -624,14 +817,56 @@ bool MsgPacket::compress(int level) {
         return true;
     }
 
+    // the upper bits of the length field hold the codec
+    if(uncompressedsize > UncompressedLengthMask) {
+        return false;
+    }
+
+    // incompressible payloads are sent as they are
     uint8_t* compressed = (uint8_t*)malloc(uncompressedsize);
-    uLongf compressedsize = uncompressedsize;
+    uint32_t compressedsize = 0;
 
     if(compressed == NULL) {
-        return NULL;
+        return false;
     }
 
-    if(::compress2(compressed, &compressedsize, getPayload(), uncompressedsize, level) != Z_OK) {
+    switch(codec) {
+#ifdef HAVE_ZLIB
+        case CodecZlib: {
+            uLongf size = uncompressedsize;
+
+            if(::compress2(compressed, &size, getPayload(), uncompressedsize, level) == Z_OK) {
+                compressedsize = size;
+            }
+
+            break;
+        }
+#endif
+#ifdef HAVE_LZ4
+        case CodecLz4: {
+            int size = LZ4_compress_default((const char*)getPayload(), (char*)compressed, uncompressedsize, uncompressedsize);
+
+            if(size > 0) {
+                compressedsize = size;
+            }
+
+            break;
+        }
+#endif
+#ifdef HAVE_ZSTD
+        case CodecZstd: {
+            size_t size = ZSTD_compress(compressed, uncompressedsize, getPayload(), uncompressedsize, level);
+
+            if(!ZSTD_isError(size)) {
+                compressedsize = size;
+            }
+
+            break;
+        }
+#endif
+    }
+
+    if(compressedsize == 0) {
         free(compressed);
         return false;
     }
@@ -648,25 +883,57 @@ bool MsgPacket::compress(int level) {
     free(compressed);
 
     m_freezed = false;
-    writePacket<uint32_t>(UncompressedPayloadLengthPos, htobe32(uncompressedsize));
+    writePacket<uint32_t>(UncompressedPayloadLengthPos, htobe32(((uint32_t)codec << CodecShift) | uncompressedsize));
     freeze();
 
     return true;
-#endif
 }
 
 bool MsgPacket::isCompressed() {
     return (be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos)) != 0);
 }
 
+int MsgPacket::getCodec() {
+    return be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos)) >> CodecShift;
+}
+
 bool MsgPacket::uncompress() {
-#ifndef HAVE_ZLIB
-    return false;
-#else
-    uLongf uncompressedsize = be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos));
+    uint32_t value = be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos));
+    uint32_t uncompressedsize = value & UncompressedLengthMask;
+    int codec = value >> CodecShift;
+
+    if(!codecAvailable(codec)) {
+        return false;
+    }
+
     uint8_t* uncompressed = (uint8_t*)malloc(uncompressedsize);
+    bool rc = false;
+
+    if(uncompressed == NULL) {
+        return false;
+    }
 
-    if(::uncompress(uncompressed, &uncompressedsize, getPayload(), getPayloadLength()) != Z_OK) {
+    switch(codec) {
+#ifdef HAVE_ZLIB
+        case CodecZlib: {
+            uLongf size = uncompressedsize;
+            rc = (::uncompress(uncompressed, &size, getPayload(), getPayloadLength()) == Z_OK && size == uncompressedsize);
+            break;
+        }
+#endif
+#ifdef HAVE_LZ4
+        case CodecLz4:
+            rc = (LZ4_decompress_safe((const char*)getPayload(), (char*)uncompressed, getPayloadLength(), uncompressedsize) == (int)uncompressedsize);
+            break;
+#endif
+#ifdef HAVE_ZSTD
+        case CodecZstd:
+            rc = (ZSTD_decompress(uncompressed, uncompressedsize, getPayload(), getPayloadLength()) == uncompressedsize);
+            break;
+#endif
+    }
+
+    if(!rc) {
         free(uncompressed);
         return false;
     }
@@ -688,7 +955,6 @@ bool MsgPacket::uncompress() {
     freeze();
 
     return true;
-#endif
 }
 
 void MsgPacket::print() {
@@ -10,6 +10,9 @@
 #include <pthread.h>
 #include <string.h>
 #include <string>
+#include <memory>
+#include <vector>
+#include <sys/uio.h>
 
 #include <ostream>
 #include <istream>
@@ -25,7 +28,8 @@
 // 14     uint16_t   protocol version
 // 16     uint32_t   payload checksum (0 if payload checksums are disabled)
 // 20     uint32_t   payload length
-// 24     uint32_t   uncompressed payload length (indicates compression if > 0)
+// 24     uint32_t   uncompressed payload length (bits 0 - 27, indicates compression if > 0)
+//                   and compression codec (bits 28 - 31, 0 = zlib, 1 = LZ4, 2 = Zstd)
 // 28     uint32_t   header checksum
 
 /**
@@ -150,6 +154,27 @@ public:
     */
     bool put_Blob(uint8_t source[], uint32_t length);
 
+    /**
+    Insert a reference to a binary large object.
+    Adds a binary object owned by another packet to the payload without copying it.
+    The source packet is kept alive until this packet is destroyed. Packets containing
+    references can only be sent (write), they can't be read back or compressed.
+    @param	source		packet owning the blob data
+    @param	data		pointer to blob data
+    @param	length		size of the blob in bytes
+    @return true on success / false on memory allocation error
+    */
+    bool put_Reference(const std::shared_ptr<MsgPacket>& source, uint8_t* data, uint32_t length);
+
+    /**
+    Insert the payload of another packet.
+    Copies the payload data of the source packet. Data referenced by the source packet
+    is shared (not copied).
+    @param	source		source packet
+    @return true on success / false on memory allocation error
+    */
+    bool put_Payload(MsgPacket* source);
+
     /**
     Reserve space.
     Creates a memory region in the payload of the packet.
@@ -408,17 +433,67 @@ public:
     */
     void setType(uint16_t type);
 
+    /**
+    Compression codecs (stored in the upper bits of the uncompressed payload length)
+    */
+    enum Codec {
+        CodecZlib = 0,
+        CodecLz4 = 1,
+        CodecZstd = 2
+    };
+
+    /**
+    Check if a compression codec is supported by this build.
+
+    @param codec compression codec
+    @return true if the codec is available
+    */
+    static bool codecAvailable(int codec);
+
+    /**
+    Highest compression level of a codec.
+
+    @param codec compression codec
+    @return maximum level (zlib: 9, LZ4: 1, Zstd: 19)
+    */
+    static int maxCompressionLevel(int codec);
+
+    /**
+    Set the compression used by compress().
+    Usually the settings negotiated with the client.
+
+    @param codec compression codec
+    @param level compression level (0 disables compression)
+    */
+    void setCompression(int codec, int level);
+
+    /**
+    Compress packet.
+    Compress the payload of the packet with the codec and level set by setCompression()
+
+    @return true on success
+    */
+    bool compress();
+
     /**
     Compress packet.
     Compress the payload of the packet
 
-    @param level compression level (1 - 9)
+    @param level compression level (1 - maxCompressionLevel())
+    @param codec compression codec
     @return true on success
     */
-    bool compress(int level);
+    bool compress(int level, int codec = CodecZlib);
 
     bool isCompressed();
 
+    /**
+    Get the codec of a compressed packet.
+
+    @return compression codec
+    */
+    int getCodec();
+
     /**
     Uncompress packet.
     Uncompress the payload of the packet
@@ -438,6 +513,14 @@ public:
     */
     bool write(int fd, int timeout_ms = 3000);
 
+    /**
+    Append the buffers of the (frozen) packet for a vectored write.
+    The buffers stay valid as long as the packet exists.
+
+    @param	iov		vector receiving the buffers
+    */
+    void gather(std::vector<struct iovec>& iov);
+
     /**
     Receive packet from socket.
     Create a new packet from incoming socket data
@@ -461,10 +544,33 @@ public:
 
     static bool readstream(std::istream& in, MsgPacket& p);
 
+    static bool writestream(std::ostream& out, MsgPacket& p);
+
+    /**
+    Receive packet from memory.
+    Create a new packet from a memory buffer holding a complete packet
+    @param	data		pointer to the packet data
+    @param	datalen		number of bytes available in the buffer
+    @return pointer to new packet or NULL if the buffer doesn't contain a valid packet
+    */
+    static MsgPacket* readbuffer(const uint8_t* data, size_t datalen);
+
+    /**
+    Replace the contents of the packet with a complete packet from memory.
+    The packet object can be reused this way without reallocation.
+
+    @param	data		pointer to the packet data
+    @param	datalen		number of bytes available in the buffer
+    @return true on success / false if the buffer doesn't contain a valid packet
+    */
+    bool load(const uint8_t* data, size_t datalen);
+
     enum {
         HeaderLength = 32,						/*!< Length (in bytes) of a packet header. */
         CheckSumPos = 28,						/*!< Checksum position (uint32_t) within the header data. */
         UncompressedPayloadLengthPos = 24,		/*!< uncompressed payload length position (uint32_t). only compressed packets have this value set. */
+        UncompressedLengthMask = 0x0FFFFFFF,	/*!< uncompressed payload length bits, the upper 4 bits hold the codec. */
+        CodecShift = 28,						/*!< bit position of the codec in the uncompressed payload length. */
         PayloadLengthPos = 20,					/*!< payload length position (uint32_t). */
         PayloadCheckSumPos = 16,				/*!< checksum position of the payload (uint32_t). */
         ProtocolVersionPos = 14,				/*!< protocol-version position (uint16_t). */
@@ -514,8 +620,23 @@ private:
 
     bool checkPacketSize(uint32_t bytes);
 
+    static uint32_t crc32Update(uint32_t crc, const uint8_t* buf, int size);
+
+    bool writeReferences(int fd, int timeout_ms);
+
+    // payload data stored in other packets
+    struct Reference {
+        uint32_t position;
+        std::shared_ptr<MsgPacket> source;
+        uint8_t* data;
+        uint32_t length;
+    };
+
+    std::vector<Reference> m_references;
+
+    uint32_t m_referenceLength = 0;
+
     static uint32_t globalUID;
-    static uint32_t crc32_tab[];
 
     uint8_t* m_packet;
     uint32_t m_size;
@@ -525,6 +646,9 @@ private:
     bool m_freezed;
     bool m_payloadchecksum;
 
+    int m_compressionCodec = CodecZlib;
+    int m_compressionLevel = 9;
+
     enum {
         InitialPacketSize = 128,
         IncrementPacketSize = 512
@@ -534,7 +658,8 @@ private:
 };
 
 inline std::ostream& operator<<(std::ostream& out, MsgPacket& p) {
-    return out.write((const char*)p.getPacket(), p.getPacketLength());
+    MsgPacket::writestream(out, p);
+    return out;
 }
 
 inline std::istream& operator>>(std::istream& in, MsgPacket& p) {
@@ -581,7 +706,9 @@ class MsgPacket {
 +uint8_t* consume(uint32_t length)
 +void clear()
 .. compression ..
-+bool compress(int level)
++void setCompression(int codec, int level)
++bool compress()
++bool compress(int level, int codec)
 +bool uncompress()
 .. transport ..
 +{static} MsgPacket* read(int fd, bool& closed, int timeout_ms)
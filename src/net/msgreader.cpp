@@ -0,0 +1,155 @@
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "os-config.h"
+#include "msgpacket.h"
+#include "msgreader.h"
+#include "crc32.h"
+
+MsgReader::MsgReader() : m_buffer(BufferSize) {
+}
+
+MsgReader::~MsgReader() {
+    for(auto p : m_pool) {
+        delete p;
+    }
+}
+
+void MsgReader::compact() {
+    if(m_begin == 0) {
+        return;
+    }
+
+    memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+    m_end -= m_begin;
+    m_begin = 0;
+}
+
+bool MsgReader::fill(int fd, bool& closed, int timeout_ms) {
+    closed = false;
+
+    if(timeout_ms != 0 && !pollfd(fd, timeout_ms, true)) {
+        return false;
+    }
+
+    if(m_end == m_buffer.size()) {
+        compact();
+    }
+
+    // incomplete packet larger than the buffer (next() requested more space)
+    if(m_end == m_buffer.size()) {
+        m_buffer.resize(m_buffer.size() * 2);
+    }
+
+    int rc = recv(fd, m_buffer.data() + m_end, m_buffer.size() - m_end, MSG_DONTWAIT);
+
+    if(rc == -1 && sockerror() == ENOTSOCK) {
+        rc = ::read(fd, m_buffer.data() + m_end, m_buffer.size() - m_end);
+    }
+
+    if(rc == 0) {
+        closed = true;
+        return false;
+    }
+
+    if(rc == -1) {
+        int err = sockerror();
+        closed = (err != SEWOULDBLOCK && err != EINTR);
+        return false;
+    }
+
+    m_end += rc;
+    return true;
+}
+
+MsgPacket* MsgReader::next() {
+    while(m_end - m_begin >= MsgPacket::HeaderLength) {
+        const uint8_t* data = m_buffer.data() + m_begin;
+
+        // hunt for sync
+        if(data[0] != 0x00 || data[1] != 0xAA || data[2] != 0xAA || data[3] != 0xAA) {
+            m_begin++;
+            continue;
+        }
+
+        // validate the header before trusting the payload length
+        uint32_t checksum = 0;
+        memcpy(&checksum, data + MsgPacket::CheckSumPos, sizeof(checksum));
+
+        if(be32toh(checksum) != crc32Buffer(data, MsgPacket::CheckSumPos)) {
+            m_begin++;
+            continue;
+        }
+
+        uint32_t payloadlen = 0;
+        memcpy(&payloadlen, data + MsgPacket::PayloadLengthPos, sizeof(payloadlen));
+        payloadlen = be32toh(payloadlen);
+
+        if(payloadlen > MaxPayloadLength) {
+            m_begin++;
+            continue;
+        }
+
+        size_t length = MsgPacket::HeaderLength + payloadlen;
+
+        // wait for the remaining payload
+        if(m_end - m_begin < length) {
+            compact();
+
+            if(m_buffer.size() < length) {
+                m_buffer.resize(length);
+            }
+
+            return NULL;
+        }
+
+        MsgPacket* p = NULL;
+
+        if(m_pool.empty()) {
+            p = new MsgPacket(0, 0, 1);
+        }
+        else {
+            p = m_pool.back();
+            m_pool.pop_back();
+        }
+
+        // corrupt header or payload, resync
+        if(!p->load(data, length)) {
+            recycle(p);
+            m_begin++;
+            continue;
+        }
+
+        m_begin += length;
+        return p;
+    }
+
+    // keep the tail at the start of the buffer
+    if(m_begin == m_end) {
+        m_begin = m_end = 0;
+    }
+
+    // release the memory of an oversized request (less than a header left)
+    if(m_buffer.size() > BufferSize) {
+        compact();
+        m_buffer.resize(BufferSize);
+        m_buffer.shrink_to_fit();
+    }
+
+    return NULL;
+}
+
+void MsgReader::recycle(MsgPacket* p) {
+    if(p == NULL) {
+        return;
+    }
+
+    if(m_pool.size() >= MaxPoolSize) {
+        delete p;
+        return;
+    }
+
+    m_pool.push_back(p);
+}
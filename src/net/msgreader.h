@@ -0,0 +1,75 @@
+/** \file msgreader.h
+    Header file for the MsgReader class.
+    Buffered socket reader for MsgPackets.
+*/
+
+#ifndef MSGREADER_H
+#define MSGREADER_H
+
+#include <stdint.h>
+#include <vector>
+
+class MsgPacket;
+
+/**
+    Receives packets with as few syscalls as possible.
+
+    Incoming data is collected in a per-connection buffer with one recv()
+    per call of fill(). Any number of complete packets can then be taken
+    out with next(). Processed packets should be handed back with recycle()
+    so their memory can be reused for the following requests.
+*/
+class MsgReader {
+public:
+
+    MsgReader();
+
+    ~MsgReader();
+
+    /**
+    Wait for incoming data and append it to the receive buffer.
+
+    @param	fd			filedescriptor of the socket
+    @param	closed		set to true if the connection was closed
+    @param	timeout_ms	timeout in milliseconds (0: don't wait, the socket is readable)
+    @return true if new data was received
+    */
+    bool fill(int fd, bool& closed, int timeout_ms);
+
+    /**
+    Take the next complete packet out of the receive buffer.
+
+    @return packet or NULL if there is no complete packet
+    */
+    MsgPacket* next();
+
+    /**
+    Return a processed packet for reuse.
+
+    @param	p		packet previously returned by next()
+    */
+    void recycle(MsgPacket* p);
+
+private:
+
+    MsgReader(const MsgReader& orig);
+
+    void compact();
+
+    std::vector<uint8_t> m_buffer;
+
+    size_t m_begin = 0;
+
+    size_t m_end = 0;
+
+    std::vector<MsgPacket*> m_pool;
+
+    enum {
+        BufferSize = 64 * 1024,
+        MaxPayloadLength = 4 * 1024 * 1024,
+        MaxPoolSize = 4
+    };
+
+};
+
+#endif // MSGREADER_H
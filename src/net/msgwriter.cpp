@@ -0,0 +1,103 @@
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+
+#include "os-config.h"
+#include "msgpacket.h"
+#include "msgwriter.h"
+
+MsgWriter::~MsgWriter() {
+    for(auto& e : m_packets) {
+        delete e.packet;
+    }
+}
+
+void MsgWriter::add(std::deque<MsgPacket*>& packets) {
+    // drop buffers already written
+    if(m_index > 0) {
+        m_iov.erase(m_iov.begin(), m_iov.begin() + m_index);
+
+        for(auto& e : m_packets) {
+            e.iovEnd -= m_index;
+        }
+
+        m_index = 0;
+    }
+
+    for(auto p : packets) {
+        p->gather(m_iov);
+        m_packets.push_back({p, m_iov.size()});
+    }
+
+    packets.clear();
+}
+
+void MsgWriter::release() {
+    // skip empty buffers
+    while(m_index < m_iov.size() && m_iov[m_index].iov_len == 0) {
+        m_index++;
+    }
+
+    // delete completely written packets
+    while(!m_packets.empty() && m_packets.front().iovEnd <= m_index) {
+        delete m_packets.front().packet;
+        m_packets.pop_front();
+    }
+
+    if(m_index == m_iov.size()) {
+        m_iov.clear();
+        m_index = 0;
+    }
+}
+
+bool MsgWriter::flush(int fd) {
+    release();
+
+    while(pending()) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &m_iov[m_index];
+        msg.msg_iovlen = std::min(m_iov.size() - m_index, (size_t)IOV_MAX);
+
+        ssize_t rc = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        if(rc == -1 && sockerror() == ENOTSOCK) {
+            rc = ::writev(fd, msg.msg_iov, msg.msg_iovlen);
+        }
+
+        if(rc == -1) {
+            if(sockerror() == EINTR) {
+                continue;
+            }
+
+            // socket buffer full, resume later
+            return (sockerror() == SEWOULDBLOCK);
+        }
+
+        if(rc == 0) {
+            return false;
+        }
+
+        // skip completely written buffers
+        while(rc > 0) {
+            struct iovec& v = m_iov[m_index];
+
+            if((size_t)rc < v.iov_len) {
+                v.iov_base = (uint8_t*)v.iov_base + rc;
+                v.iov_len -= rc;
+                break;
+            }
+
+            rc -= v.iov_len;
+            m_index++;
+        }
+
+        release();
+    }
+
+    return true;
+}
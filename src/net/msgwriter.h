@@ -0,0 +1,72 @@
+/** \file msgwriter.h
+    Header file for the MsgWriter class.
+    Batched, non-blocking socket writer for MsgPackets.
+*/
+
+#ifndef MSGWRITER_H
+#define MSGWRITER_H
+
+#include <deque>
+#include <vector>
+#include <sys/uio.h>
+
+class MsgPacket;
+
+/**
+    Sends queued packets with as few syscalls as possible.
+
+    Packets are gathered into one iovec list and written with sendmsg().
+    A partial write is resumed on the next flush() without blocking.
+*/
+class MsgWriter {
+public:
+
+    MsgWriter() {}
+
+    ~MsgWriter();
+
+    /**
+    Append packets to the pending batch.
+    The writer takes ownership of the packets, the deque is emptied.
+
+    @param	packets		packets to send
+    */
+    void add(std::deque<MsgPacket*>& packets);
+
+    /**
+    Write as much pending data as possible without blocking.
+
+    @param	fd		filedescriptor of the socket
+    @return false on socket errors
+    */
+    bool flush(int fd);
+
+    /**
+    Check for unsent data.
+
+    @return true if there is data left to send
+    */
+    bool pending() const {
+        return m_index < m_iov.size();
+    }
+
+private:
+
+    MsgWriter(const MsgWriter& orig);
+
+    void release();
+
+    struct Entry {
+        MsgPacket* packet;
+        size_t iovEnd;
+    };
+
+    std::deque<Entry> m_packets;
+
+    std::vector<struct iovec> m_iov;
+
+    size_t m_index = 0;
+
+};
+
+#endif // MSGWRITER_H
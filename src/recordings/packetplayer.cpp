@@ -140,12 +140,7 @@ MsgPacket* PacketPlayer::getNextPacket() {
     }
 
     // put packets into demuxer
-    uint8_t* p = buffer;
-
-    for(int i = 0; i < packetCount; i++) {
-        m_demuxers.processTsPacket(p);
-        p += TS_SIZE;
-    }
+    m_demuxers.processTsPackets(buffer, packetCount * TS_SIZE);
 
     // stream change needed / requested
     if(m_requestStreamChange) {
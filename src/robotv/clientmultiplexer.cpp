@@ -0,0 +1,489 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <vdr/tools.h>
+
+#include "robotvclient.h"
+#include "clientmultiplexer.h"
+
+// interval for sending stream data to clients in push mode (ms)
+#define PUSH_INTERVAL 10
+
+#define MAX_EVENTS 64
+
+// epoll keys of the internal descriptors (client ids otherwise)
+#define KEY_WAKEUP UINT64_MAX
+#define KEY_LISTEN (UINT64_MAX - 1)
+
+int ClientMultiplexer::m_threads = 2;
+
+int ClientMultiplexer::m_workerCount = 4;
+
+ClientMultiplexer::ClientMultiplexer() {
+}
+
+ClientMultiplexer::~ClientMultiplexer() {
+    stop();
+
+    for(auto l : m_loops) {
+        delete l;
+    }
+}
+
+ClientMultiplexer& ClientMultiplexer::instance() {
+    static ClientMultiplexer multiplexer;
+    return multiplexer;
+}
+
+void ClientMultiplexer::setThreads(int threads) {
+    m_threads = std::max(1, threads);
+    isyslog("network threads: %i", m_threads);
+}
+
+void ClientMultiplexer::setWorkers(int workers) {
+    m_workerCount = std::max(1, workers);
+    isyslog("request threads: %i", m_workerCount);
+}
+
+void ClientMultiplexer::start(int listenFd, std::function<void(int)> onAccept) {
+    if(m_running) {
+        return;
+    }
+
+    m_running = true;
+    m_onAccept = onAccept;
+
+    for(int i = 0; i < m_workerCount; i++) {
+        m_workers.push_back(new std::thread([this]() {
+            work();
+        }));
+    }
+
+    if(m_loops.empty()) {
+        for(int i = 0; i < m_threads; i++) {
+            m_loops.push_back(new Loop(this));
+        }
+    }
+
+    // the first I/O thread accepts new connections
+    m_loops[0]->listenFd = listenFd;
+
+    for(auto l : m_loops) {
+        l->running = true;
+        l->thread = new std::thread([l]() {
+            l->run();
+        });
+    }
+
+    isyslog("client multiplexer started (%i network / %i request threads)", (int)m_loops.size(), m_workerCount);
+}
+
+void ClientMultiplexer::stop() {
+    if(!m_running) {
+        return;
+    }
+
+    for(auto l : m_loops) {
+        l->running = false;
+        l->wakeup();
+        l->thread->join();
+
+        delete l->thread;
+        l->thread = nullptr;
+    }
+
+    // complete all queued requests
+    {
+        std::lock_guard<std::mutex> lock(m_taskLock);
+        m_running = false;
+    }
+
+    m_taskCond.notify_all();
+
+    for(auto t : m_workers) {
+        t->join();
+        delete t;
+    }
+
+    m_workers.clear();
+
+    for(auto l : m_loops) {
+        l->clear();
+    }
+}
+
+void ClientMultiplexer::add(RoboTvClient* client) {
+    if(m_loops.empty()) {
+        return;
+    }
+
+    loop(client->getId())->post({Event::Add, client->getId(), client, false});
+}
+
+void ClientMultiplexer::notify(unsigned int id) {
+    if(m_loops.empty()) {
+        return;
+    }
+
+    loop(id)->post({Event::Notify, id, nullptr, false});
+}
+
+void ClientMultiplexer::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_taskLock);
+        m_tasks.push_back(task);
+    }
+
+    m_taskCond.notify_one();
+}
+
+void ClientMultiplexer::work() {
+    for(;;) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_taskLock);
+            m_taskCond.wait(lock, [this]() {
+                return !m_tasks.empty() || !m_running;
+            });
+
+            if(m_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+ClientMultiplexer::Loop::Loop(ClientMultiplexer* parent) : running(false), m_parent(parent) {
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = KEY_WAKEUP;
+
+    if(epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeupFd, &ev) == -1) {
+        esyslog("failed to setup client multiplexer (errno=%d: %s)", errno, strerror(errno));
+    }
+}
+
+ClientMultiplexer::Loop::~Loop() {
+    clear();
+    close(m_wakeupFd);
+    close(m_epollFd);
+}
+
+void ClientMultiplexer::Loop::clear() {
+    for(auto& i : m_connections) {
+        delete i.second->request;
+        delete i.second;
+    }
+
+    m_connections.clear();
+    m_streaming = 0;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_events.clear();
+}
+
+void ClientMultiplexer::Loop::post(const Event& event) {
+    bool empty = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        empty = m_events.empty();
+        m_events.push_back(event);
+    }
+
+    // the I/O thread already got a wakeup for the pending events
+    if(empty) {
+        wakeup();
+    }
+}
+
+void ClientMultiplexer::Loop::wakeup() {
+    uint64_t value = 1;
+
+    if(write(m_wakeupFd, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+        esyslog("failed to wakeup network thread (errno=%d)", errno);
+    }
+}
+
+void ClientMultiplexer::Loop::run() {
+    struct epoll_event events[MAX_EVENTS];
+    auto lastPush = std::chrono::steady_clock::now();
+
+    if(listenFd != -1) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = KEY_LISTEN;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    }
+
+    while(running) {
+        int rc = epoll_wait(m_epollFd, events, MAX_EVENTS, m_streaming > 0 ? PUSH_INTERVAL : -1);
+
+        if(rc == -1 && errno != EINTR) {
+            esyslog("epoll_wait failed (errno=%d: %s)", errno, strerror(errno));
+            break;
+        }
+
+        for(int i = 0; i < rc; i++) {
+            uint64_t key = events[i].data.u64;
+
+            if(key == KEY_WAKEUP) {
+                uint64_t value;
+
+                if(read(m_wakeupFd, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+                    esyslog("failed to read wakeup event (errno=%d)", errno);
+                }
+
+                processEvents();
+                continue;
+            }
+
+            if(key == KEY_LISTEN) {
+                accept();
+                continue;
+            }
+
+            auto c = m_connections.find((unsigned int)key);
+
+            if(c != m_connections.end()) {
+                handle(c->second, events[i].events);
+            }
+        }
+
+        // poll the stream of clients in push mode
+        if(m_streaming == 0) {
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+
+        if(now - lastPush < std::chrono::milliseconds(PUSH_INTERVAL)) {
+            continue;
+        }
+
+        lastPush = now;
+
+        for(auto& i : m_connections) {
+            Connection* c = i.second;
+
+            if(c->streaming && !c->busy && !c->closing) {
+                dispatch(c, nullptr);
+                update(c);
+            }
+        }
+    }
+
+    if(listenFd != -1) {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, listenFd, NULL);
+    }
+}
+
+void ClientMultiplexer::Loop::processEvents() {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_processing.swap(m_events);
+    }
+
+    for(auto& e : m_processing) {
+        if(e.type == Event::Add) {
+            Connection* c = new Connection;
+            c->client = e.client;
+            c->events = EPOLLIN;
+
+            struct epoll_event ev = {};
+            ev.events = c->events;
+            ev.data.u64 = e.id;
+
+            if(epoll_ctl(m_epollFd, EPOLL_CTL_ADD, e.client->getSocket(), &ev) == -1) {
+                esyslog("failed to register client %u (errno=%d: %s)", e.id, errno, strerror(errno));
+                delete c;
+                e.client->setClosed();
+                continue;
+            }
+
+            m_connections[e.id] = c;
+            continue;
+        }
+
+        auto i = m_connections.find(e.id);
+
+        if(i == m_connections.end()) {
+            continue;
+        }
+
+        Connection* c = i->second;
+
+        if(e.type == Event::Finished) {
+            c->busy = false;
+            c->client->recycle(c->request);
+            c->request = nullptr;
+
+            if(e.streaming != c->streaming) {
+                m_streaming += e.streaming ? 1 : -1;
+                c->streaming = e.streaming;
+            }
+        }
+
+        if(c->closing) {
+            remove(c);
+            continue;
+        }
+
+        service(c);
+    }
+
+    m_processing.clear();
+}
+
+void ClientMultiplexer::Loop::accept() {
+    for(;;) {
+        int fd = ::accept(listenFd, 0, 0);
+
+        if(fd >= 0) {
+            m_parent->m_onAccept(fd);
+            continue;
+        }
+
+        if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            esyslog("accept failed (errno=%d: %s)", errno, strerror(errno));
+        }
+
+        break;
+    }
+}
+
+void ClientMultiplexer::Loop::handle(Connection* c, uint32_t events) {
+    if(c->closing) {
+        return;
+    }
+
+    if(events & (EPOLLERR | EPOLLHUP)) {
+        remove(c);
+        return;
+    }
+
+    if((events & EPOLLIN) && !c->client->receive()) {
+        remove(c);
+        return;
+    }
+
+    service(c);
+}
+
+void ClientMultiplexer::Loop::service(Connection* c) {
+    RoboTvClient* client = c->client;
+
+    if(!client->flush()) {
+        esyslog("failed to send messages to client %u", client->getId());
+        remove(c);
+        return;
+    }
+
+    // next request of the client
+    if(!c->busy) {
+        MsgPacket* request = client->nextRequest();
+
+        if(request != nullptr) {
+            dispatch(c, request);
+        }
+    }
+
+    update(c);
+}
+
+void ClientMultiplexer::Loop::dispatch(Connection* c, MsgPacket* request) {
+    RoboTvClient* client = c->client;
+    unsigned int id = client->getId();
+    Loop* loop = this;
+
+    c->busy = true;
+    c->request = request;
+
+    m_parent->submit([client, id, request, loop]() {
+        bool streaming = client->execute(request);
+        loop->post({Event::Finished, id, nullptr, streaming});
+    });
+}
+
+void ClientMultiplexer::Loop::update(Connection* c) {
+    // don't read new requests while a request is processed
+    uint32_t events = (c->busy ? 0 : EPOLLIN) | (c->client->sending() ? EPOLLOUT : 0);
+
+    if(events == c->events) {
+        return;
+    }
+
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.u64 = c->client->getId();
+
+    if(epoll_ctl(m_epollFd, EPOLL_CTL_MOD, c->client->getSocket(), &ev) == -1) {
+        esyslog("failed to update client %u (errno=%d: %s)", c->client->getId(), errno, strerror(errno));
+    }
+
+    c->events = events;
+}
+
+void ClientMultiplexer::Loop::remove(Connection* c) {
+    RoboTvClient* client = c->client;
+
+    if(!c->closing) {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, client->getSocket(), NULL);
+        c->closing = true;
+    }
+
+    // wait for the running request
+    if(c->busy) {
+        return;
+    }
+
+    if(c->streaming) {
+        m_streaming--;
+    }
+
+    m_connections.erase(client->getId());
+    delete c;
+
+    // the client may be deleted by the server from now on
+    client->setClosed();
+}
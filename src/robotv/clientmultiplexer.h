@@ -0,0 +1,187 @@
+/*
+ *      vdr-plugin-robotv - roboTV server plugin for VDR
+ *
+ *      Copyright (C) 2016 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-robotv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef ROBOTV_CLIENTMULTIPLEXER_H
+#define ROBOTV_CLIENTMULTIPLEXER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class RoboTvClient;
+class MsgPacket;
+
+/**
+ * Event loop for all client connections.
+ *
+ * A small fixed number of I/O threads wait for socket events with epoll.
+ * Every client is bound to one I/O thread which does all reads and writes
+ * of its socket. Requests are processed on a bounded pool of worker
+ * threads, at most one request per client at a time (in order). Idle
+ * connections don't cause any wakeups, only clients in push mode are
+ * polled for new stream data.
+ */
+
+class ClientMultiplexer {
+public:
+
+    ~ClientMultiplexer();
+
+    static ClientMultiplexer& instance();
+
+    static void setThreads(int threads);
+
+    static void setWorkers(int workers);
+
+    // start the I/O threads, new connections on listenFd are passed to onAccept
+    void start(int listenFd, std::function<void(int)> onAccept);
+
+    // stop all threads (running requests are completed)
+    void stop();
+
+    // register a connected client (the caller keeps the ownership)
+    void add(RoboTvClient* client);
+
+    // the client has queued messages to send (any thread)
+    void notify(unsigned int id);
+
+protected:
+
+    ClientMultiplexer();
+
+private:
+
+    struct Connection {
+        RoboTvClient* client;
+        uint32_t events = 0;
+        bool busy = false;
+        bool closing = false;
+        bool streaming = false;
+        MsgPacket* request = nullptr;
+    };
+
+    // message to an I/O thread
+    struct Event {
+        enum Type {
+            Add,
+            Notify,
+            Finished
+        } type;
+        unsigned int id;
+        RoboTvClient* client;
+        bool streaming;
+    };
+
+    class Loop {
+    public:
+
+        Loop(ClientMultiplexer* parent);
+
+        ~Loop();
+
+        void post(const Event& event);
+
+        void wakeup();
+
+        void run();
+
+        void clear();
+
+        std::thread* thread = nullptr;
+
+        std::atomic<bool> running;
+
+        int listenFd = -1;
+
+    private:
+
+        void processEvents();
+
+        void accept();
+
+        void handle(Connection* c, uint32_t events);
+
+        void service(Connection* c);
+
+        void dispatch(Connection* c, MsgPacket* request);
+
+        void update(Connection* c);
+
+        void remove(Connection* c);
+
+        ClientMultiplexer* m_parent;
+
+        int m_epollFd;
+
+        int m_wakeupFd;
+
+        std::map<unsigned int, Connection*> m_connections;
+
+        int m_streaming = 0;
+
+        std::mutex m_lock;
+
+        std::vector<Event> m_events;
+
+        std::vector<Event> m_processing;
+
+    };
+
+    void submit(std::function<void()> task);
+
+    void work();
+
+    Loop* loop(unsigned int id) {
+        return m_loops[id % m_loops.size()];
+    }
+
+    std::vector<Loop*> m_loops;
+
+    std::function<void(int)> m_onAccept;
+
+    // worker pool
+    std::vector<std::thread*> m_workers;
+
+    std::deque<std::function<void()>> m_tasks;
+
+    std::mutex m_taskLock;
+
+    std::condition_variable m_taskCond;
+
+    bool m_running = false;
+
+    static int m_threads;
+
+    static int m_workerCount;
+
+};
+
+#endif // ROBOTV_CLIENTMULTIPLEXER_H
@@ -184,7 +184,7 @@ bool EpgController::processGet(MsgPacket* request, MsgPacket* response) {
     }
 
     c.unlock();
-    response->compress(9);
+    response->compress();
 
     return true;
 }
@@ -229,7 +229,7 @@ bool EpgController::processSearch(MsgPacket* request, MsgPacket* response) {
         response->put_U32(createChannelUid(channel));
     });
 
-    response->compress(9);
+    response->compress();
     c.unlock();
     return true;
 }
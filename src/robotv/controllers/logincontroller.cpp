@@ -22,6 +22,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "logincontroller.h"
 #include "net/msgpacket.h"
 #include "config/config.h"
@@ -52,6 +54,7 @@ bool LoginController::processLogin(MsgPacket* request, MsgPacket* response) {
     m_protocolVersion = request->getProtocolVersion();
     m_compressionLevel = request->get_U8();
     const char* clientName = request->get_String();
+    m_clientName = clientName;
     m_statusInterfaceEnabled = request->get_U8();
     m_socketPriority = request->get_U8();
 
@@ -63,12 +66,27 @@ bool LoginController::processLogin(MsgPacket* request, MsgPacket* response) {
         setsockopt(m_socket, SOL_SOCKET, SO_PRIORITY, &m_socketPriority, sizeof(m_socketPriority));
     }
 
+    // compression codec (protocol version 11)
+    m_compressionCodec = MsgPacket::CodecZlib;
+
+    if(m_protocolVersion >= 11 && !request->eop()) {
+        m_compressionCodec = request->get_U8();
+    }
+
+    if(!MsgPacket::codecAvailable(m_compressionCodec)) {
+        isyslog("Compression codec %i not available, using zlib", m_compressionCodec);
+        m_compressionCodec = MsgPacket::CodecZlib;
+    }
+
+    m_compressionLevel = std::min(std::max(m_compressionLevel, 0), MsgPacket::maxCompressionLevel(m_compressionCodec));
+
     if(m_protocolVersion > ROBOTV_PROTOCOLVERSION || m_protocolVersion < 7) {
         esyslog("Client '%s' has unsupported protocol version '%u', terminating client", clientName, m_protocolVersion);
         return false;
     }
 
     isyslog("Welcome client '%s' with protocol version '%u' and priority %i", clientName, m_protocolVersion, m_socketPriority);
+    isyslog("Compression codec %i, level %i", m_compressionCodec, m_compressionLevel);
 
     // Send the login reply
     time_t timeNow = time(NULL);
@@ -81,6 +99,12 @@ bool LoginController::processLogin(MsgPacket* request, MsgPacket* response) {
     response->put_String("roboTV VDR Server");
     response->put_String(ROBOTV_VERSION);
 
+    // negotiated compression
+    if(m_protocolVersion >= 11) {
+        response->put_U8(m_compressionCodec);
+        response->put_U8(m_compressionLevel);
+    }
+
     m_loggedIn = true;
     return true;
 }
@@ -26,6 +26,7 @@
 #define ROBOTV_LOGINCONTROLLER_H
 
 #include <stdint.h>
+#include <string>
 #include "controller.h"
 
 class MsgPacket;
@@ -51,6 +52,18 @@ public:
         return m_loggedIn;
     }
 
+    int compressionCodec() const {
+        return m_compressionCodec;
+    }
+
+    int compressionLevel() const {
+        return m_compressionLevel;
+    }
+
+    const std::string& clientName() const {
+        return m_clientName;
+    }
+
     void setSocket(int fd) {
         m_socket = fd;
     }
@@ -67,6 +80,8 @@ private:
 
     uint32_t m_protocolVersion = 0;
 
+    int m_compressionCodec = 0;
+
     int m_compressionLevel = 0;
 
     bool m_loggedIn = false;
@@ -77,6 +92,8 @@ private:
 
     int m_socket = -1;
 
+    std::string m_clientName;
+
 };
 
 #endif // ROBOTV_LOGINCONTROLLER_H
@@ -116,7 +116,7 @@ bool MovieController::processGetFolders(MsgPacket* request, MsgPacket* response)
         response->put_String(folder);
     }
 
-    response->compress(9);
+    response->compress();
     return true;
 }
 
@@ -125,7 +125,7 @@ bool MovieController::processGetList(MsgPacket* request, MsgPacket* response) {
         recordingToPacket(recording, response);
     }
 
-    response->compress(9);
+    response->compress();
     return true;
 
 }
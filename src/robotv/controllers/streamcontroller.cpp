@@ -26,6 +26,8 @@
 #include "config/config.h"
 #include "robotv/robotvchannels.h"
 #include "robotv/robotvclient.h"
+#include "live/livesessions.h"
+#include "live/livestandby.h"
 #include "tools/hash.h"
 
 StreamController::StreamController(RoboTvClient* parent) :
@@ -37,7 +39,19 @@ StreamController::StreamController(const StreamController& orig) {
 }
 
 StreamController::~StreamController() {
-    stopStreaming();
+    LiveStandby::instance().remove(m_parent->getId());
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    // keep the timeshift session for a reconnecting client
+    if(m_streamer != NULL && !m_sessionToken.empty()) {
+        LiveSessions::instance().park(m_sessionToken, m_sessionOwner, m_streamer);
+        m_streamer = NULL;
+        return;
+    }
+
+    delete m_streamer;
+    m_streamer = NULL;
 }
 
 bool StreamController::process(MsgPacket* request, MsgPacket* response) {
@@ -61,6 +75,15 @@ bool StreamController::process(MsgPacket* request, MsgPacket* response) {
 
         case ROBOTV_CHANNELSTREAM_SEEK:
             return processSeek(request, response);
+
+        case ROBOTV_CHANNELSTREAM_RESUME:
+            return processResume(request, response);
+
+        case ROBOTV_CHANNELSTREAM_PUSH:
+            return processPush(request, response);
+
+        case ROBOTV_CHANNELSTREAM_STATS:
+            return processStats(request, response);
     }
 
     return false;
@@ -85,12 +108,27 @@ bool StreamController::processOpen(MsgPacket* request, MsgPacket* response) {
         m_langStreamType = (StreamInfo::Type)request->get_U8();
     }
 
+    // get timeshift session token
+    std::string sessionToken;
+
+    if(!request->eop()) {
+        sessionToken = request->get_String();
+    }
+
     if(!m_language.empty()) {
         isyslog("Preferred language: %s / type: %i", m_language.c_str(), (int)m_langStreamType);
     }
 
     stopStreaming();
 
+    // a new stream replaces any parked session
+    m_sessionToken = sessionToken;
+    m_sessionOwner = m_parent->getClientName();
+
+    if(!m_sessionToken.empty()) {
+        LiveSessions::instance().remove(m_sessionToken, m_sessionOwner);
+    }
+
     RoboTVChannels& c = RoboTVChannels::instance();
     c.lock(false);
     const cChannel* channel = NULL;
@@ -120,6 +158,7 @@ bool StreamController::processOpen(MsgPacket* request, MsgPacket* response) {
     if(status == ROBOTV_RET_OK) {
         isyslog("--------------------------------------");
         isyslog("Started streaming of channel %s (priority %i)", channel->Name(), priority);
+        LiveStandby::instance().update(m_parent->getId(), channel);
     }
     else {
         esyslog("Can't stream channel %s (status: %i)", channel->Name(), status);
@@ -131,6 +170,37 @@ bool StreamController::processOpen(MsgPacket* request, MsgPacket* response) {
 
 bool StreamController::processClose(MsgPacket* request, MsgPacket* response) {
     stopStreaming();
+    m_sessionToken.clear();
+    return true;
+}
+
+bool StreamController::processResume(MsgPacket* request, MsgPacket* response) {
+    std::string sessionToken = request->get_String();
+
+    stopStreaming();
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    LiveStreamer* streamer = LiveSessions::instance().resume(sessionToken, m_parent->getClientName());
+
+    if(streamer == NULL) {
+        isyslog("timeshift session '%s' not found", sessionToken.c_str());
+        response->put_U32(ROBOTV_RET_DATAUNKNOWN);
+        return true;
+    }
+
+    int status = streamer->resume(m_parent);
+
+    if(status != ROBOTV_RET_OK) {
+        delete streamer;
+        response->put_U32(status);
+        return true;
+    }
+
+    m_streamer = streamer;
+    m_sessionToken = sessionToken;
+    m_sessionOwner = m_parent->getClientName();
+
+    response->put_U32(ROBOTV_RET_OK);
     return true;
 }
 
@@ -147,11 +217,9 @@ bool StreamController::processRequest(MsgPacket* request, MsgPacket* response) {
         return true;
     }
 
-    int packetLen = p->getPayloadLength();
-    uint8_t* packetData = p->consume(packetLen);
-
+    // frame data is shared with the stream packet, not copied
     response->setMsgID(p->getMsgID());
-    response->put_Blob(packetData, packetLen);
+    response->put_Payload(p);
     delete p;
 
     return true;
@@ -175,10 +243,25 @@ bool StreamController::processSignal(MsgPacket* request, MsgPacket* response) {
         return false;
     }
 
-    m_streamer->requestSignalInfo();
+    m_streamer->requestSignalInfo(request->getProtocolVersion() >= 12);
     return false;
 }
 
+bool StreamController::processStats(MsgPacket* request, MsgPacket* response) {
+    // not available before protocol version 12
+    if(request->getProtocolVersion() < 12) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if(m_streamer == NULL) {
+        return false;
+    }
+
+    return m_streamer->putStreamStats(response);
+}
+
 void StreamController::processChannelChange(const cChannel* Channel) {
     if(m_streamer != NULL) {
         m_streamer->processChannelChange(Channel);
@@ -201,6 +284,68 @@ void StreamController::stopStreaming() {
 
     delete m_streamer;
     m_streamer = NULL;
+
+    m_pushMode = false;
+    m_pushCredit = 0;
+    m_pushKeyFrameMode = false;
+}
+
+bool StreamController::processPush(MsgPacket* request, MsgPacket* response) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    uint32_t credit = request->get_U32();
+    bool keyFrameMode = false;
+
+    if(!request->eop()) {
+        keyFrameMode = request->get_U8();
+    }
+
+    if(m_streamer == NULL) {
+        response->put_U32(ROBOTV_RET_DATAINVALID);
+        return true;
+    }
+
+    if(!m_pushMode) {
+        isyslog("LIVESTREAM: push mode enabled");
+    }
+
+    m_pushMode = true;
+    m_pushCredit += credit;
+    m_pushKeyFrameMode = keyFrameMode;
+
+    response->put_U32(ROBOTV_RET_OK);
+    return true;
+}
+
+void StreamController::pushPackets() {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if(!m_pushMode || m_streamer == NULL) {
+        return;
+    }
+
+    // the last packet may exceed the window, the client
+    // has to grant new credit before we continue
+    while(m_pushCredit > 0) {
+        MsgPacket* p = m_streamer->requestPacket(m_pushKeyFrameMode, true);
+
+        if(p == NULL) {
+            break;
+        }
+
+        MsgPacket* packet = new MsgPacket(ROBOTV_STREAM_MUXPKT, ROBOTV_CHANNEL_STREAM);
+        packet->disablePayloadCheckSum();
+        packet->put_Payload(p);
+        delete p;
+
+        m_pushCredit -= packet->getPayloadLength();
+        m_parent->queueMessage(packet);
+    }
+}
+
+bool StreamController::pushing() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pushMode && m_streamer != NULL && m_pushCredit > 0;
 }
 
 bool StreamController::processSeek(MsgPacket* request, MsgPacket* response) {
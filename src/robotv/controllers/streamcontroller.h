@@ -44,6 +44,12 @@ public:
 
     void processChannelChange(const cChannel* Channel);
 
+    // send available stream data to the client (push mode)
+    void pushPackets();
+
+    // push mode enabled and credit left
+    bool pushing();
+
 protected:
 
     bool processOpen(MsgPacket* request, MsgPacket* response);
@@ -58,6 +64,12 @@ protected:
 
     bool processSeek(MsgPacket* request, MsgPacket* response);
 
+    bool processResume(MsgPacket* request, MsgPacket* response);
+
+    bool processPush(MsgPacket* request, MsgPacket* response);
+
+    bool processStats(MsgPacket* request, MsgPacket* response);
+
 private:
 
     StreamController(const StreamController& orig);
@@ -68,6 +80,18 @@ private:
 
     std::string m_language;
 
+    std::string m_sessionToken;
+
+    // client name the session token is bound to
+    std::string m_sessionOwner;
+
+    // push mode flow control (remaining bytes the client accepts)
+    bool m_pushMode = false;
+
+    int64_t m_pushCredit = 0;
+
+    bool m_pushKeyFrameMode = false;
+
     StreamInfo::Type m_langStreamType;
 
     LiveStreamer* m_streamer = NULL;
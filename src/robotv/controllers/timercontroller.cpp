@@ -296,7 +296,7 @@ bool TimerController::processGetSearchTimers(MsgPacket* request, MsgPacket* resp
 
     delete service;
 
-    response->compress(9);
+    response->compress();
     return true;
 }
 
@@ -35,8 +35,11 @@
 #include "robotvcommand.h"
 #include "robotvclient.h"
 #include "robotvserver.h"
+#include "clientmultiplexer.h"
 
 RoboTvClient::RoboTvClient(int fd, unsigned int id) : m_id(id), m_socket(fd),
+    m_flushPending(false),
+    m_closed(false),
     m_streamController(this),
     m_recordingController(this),
     m_timerController(this) {
@@ -53,13 +56,11 @@ RoboTvClient::RoboTvClient(int fd, unsigned int id) : m_id(id), m_socket(fd),
     };
 
     m_loginController.setSocket(m_socket);
-    Start();
 }
 
 RoboTvClient::~RoboTvClient() {
     // shutdown connection
     shutdown(m_socket, SHUT_RDWR);
-    Cancel(10);
 
     // close connection
     close(m_socket);
@@ -78,40 +79,44 @@ RoboTvClient::~RoboTvClient() {
     dsyslog("done");
 }
 
-void RoboTvClient::Action(void) {
-    bool bClosed(false);
+bool RoboTvClient::receive() {
+    bool closed = false;
+    m_reader.fill(m_socket, closed, 0);
 
-    while(Running()) {
-
-        // send pending messages
-        {
-            std::lock_guard<std::mutex> lock(m_queueLock);
+    return !closed;
+}
 
-            while(!m_queue.empty()) {
-                MsgPacket* p = m_queue.front();
+MsgPacket* RoboTvClient::nextRequest() {
+    return m_reader.next();
+}
 
-                if(!p->write(m_socket, m_timeout)) {
-                    break;
-                }
+void RoboTvClient::recycle(MsgPacket* request) {
+    m_reader.recycle(request);
+}
 
-                m_queue.pop_front();
-                delete p;
-            }
-        }
+bool RoboTvClient::flush() {
+    std::deque<MsgPacket*> batch;
+    m_flushPending = false;
 
-        m_request = MsgPacket::read(m_socket, bClosed, 10);
+    // take all pending messages, producers are only blocked for the swap
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        batch.swap(m_queue);
+    }
 
-        if(bClosed) {
-            delete m_request;
-            m_request = NULL;
-            break;
-        }
+    m_writer.add(batch);
+    return m_writer.flush(m_socket);
+}
 
-        if(m_request != NULL) {
-            processRequest();
-            delete m_request;
-        }
+bool RoboTvClient::execute(MsgPacket* request) {
+    if(request != NULL) {
+        m_request = request;
+        processRequest();
+        m_request = NULL;
     }
+
+    m_streamController.pushPackets();
+    return m_streamController.pushing();
 }
 
 void RoboTvClient::Recording(const cDevice* Device, const char* Name, const char* FileName, bool On) {
@@ -159,7 +164,7 @@ void RoboTvClient::TimerChange(const cTimer* Timer, eTimerChange Change) {
 }
 
 void RoboTvClient::ChannelChange(const cChannel* Channel) {
-    if(!Running()) {
+    if(m_closed) {
         return;
     }
 
@@ -221,6 +226,7 @@ bool RoboTvClient::processRequest() {
 
     m_response = new MsgPacket(m_request->getMsgID(), ROBOTV_CHANNEL_REQUEST_RESPONSE, m_request->getUID());
     m_response->setProtocolVersion(m_loginController.protocolVersion());
+    m_response->setCompression(m_loginController.compressionCodec(), m_loginController.compressionLevel());
 
     for(auto i : m_controllers) {
         if(i->process(m_request, m_response)) {
@@ -234,6 +240,13 @@ bool RoboTvClient::processRequest() {
 }
 
 void RoboTvClient::queueMessage(MsgPacket* p) {
-    std::lock_guard<std::mutex> lock(m_queueLock);
-    m_queue.push_back(p);
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        m_queue.push_back(p);
+    }
+
+    // wake up the network thread once per batch
+    if(!m_flushPending.exchange(true)) {
+        ClientMultiplexer::instance().notify(m_id);
+    }
 }
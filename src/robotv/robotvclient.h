@@ -25,11 +25,12 @@
 #ifndef ROBOTV_CLIENT_H
 #define ROBOTV_CLIENT_H
 
+#include <atomic>
 #include <list>
 #include <string>
 #include <deque>
 #include <map>
-#include <thread>
+#include <mutex>
 
 #include <vdr/tools.h>
 #include <vdr/receiver.h>
@@ -37,6 +38,8 @@
 
 #include "robotvdmx/streaminfo.h"
 #include "net/msgpacket.h"
+#include "net/msgreader.h"
+#include "net/msgwriter.h"
 #include "recordings/artwork.h"
 
 #include "controllers/streamcontroller.h"
@@ -52,7 +55,7 @@ class cChannel;
 class cDevice;
 class PacketPlayer;
 
-class RoboTvClient : public cThread, public cStatus {
+class RoboTvClient : public cStatus {
 private:
 
     unsigned int m_id;
@@ -65,10 +68,19 @@ private:
 
     Utf8Conv m_toUtf8;
 
-    int m_timeout = 3000;
-
     std::deque<MsgPacket*> m_queue;
 
+    // buffered reads of incoming requests
+    MsgReader m_reader;
+
+    // batched writes of the queued messages
+    MsgWriter m_writer;
+
+    // the network thread has been notified about queued messages
+    std::atomic<bool> m_flushPending;
+
+    std::atomic<bool> m_closed;
+
     std::mutex m_queueLock;
 
     // Controllers
@@ -95,7 +107,28 @@ protected:
 
     bool processRequest();
 
-    virtual void Action(void);
+    // network thread (ClientMultiplexer)
+
+    bool receive();
+
+    MsgPacket* nextRequest();
+
+    void recycle(MsgPacket* request);
+
+    bool flush();
+
+    bool sending() const {
+        return m_writer.pending();
+    }
+
+    void setClosed() {
+        m_closed = true;
+    }
+
+    // worker thread (ClientMultiplexer), returns true while in push mode
+    bool execute(MsgPacket* request);
+
+    friend class ClientMultiplexer;
 
     virtual void Recording(const cDevice* Device, const char* Name, const char* FileName, bool On);
     virtual void TimerChange(const cTimer* Timer, eTimerChange Change);
@@ -119,10 +152,19 @@ public:
         return m_id;
     }
 
+    const std::string& getClientName() const {
+        return m_loginController.clientName();
+    }
+
     int getSocket() const {
         return m_socket;
     }
 
+    // the connection has been closed and the client can be deleted
+    bool closed() const {
+        return m_closed;
+    }
+
 };
 
 #endif // ROBOTV_CLIENT_H
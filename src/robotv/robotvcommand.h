@@ -26,7 +26,7 @@
 #define ROBOTV_COMMAND_H
 
 /** Current RoboTV Protocol Version number */
-#define ROBOTV_PROTOCOLVERSION          8
+#define ROBOTV_PROTOCOLVERSION          12
 
 
 /** Packet types */
@@ -53,6 +53,9 @@
 #define ROBOTV_CHANNELSTREAM_PAUSE   23
 #define ROBOTV_CHANNELSTREAM_SIGNAL  24
 #define ROBOTV_CHANNELSTREAM_SEEK    25
+#define ROBOTV_CHANNELSTREAM_RESUME  26
+#define ROBOTV_CHANNELSTREAM_PUSH    27
+#define ROBOTV_CHANNELSTREAM_STATS   28
 
 /* OPCODE 40 - 59: RoboTV network functions for recording streaming */
 #define ROBOTV_RECSTREAM_OPEN        40
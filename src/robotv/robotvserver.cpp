@@ -42,7 +42,11 @@
 #include "robotvserver.h"
 #include "robotvclient.h"
 #include "robotvchannels.h"
+#include "clientmultiplexer.h"
 #include "live/channelcache.h"
+#include "live/demuxerpool.h"
+#include "live/livesessions.h"
+#include "live/livestandby.h"
 #include "recordings/recordingscache.h"
 #include "recordings/artwork.h"
 #include "net/os-config.h"
@@ -140,10 +144,16 @@ RoboTVServer::RoboTVServer(int listenPort) : cThread("roboTV VDR Server"), m_con
 RoboTVServer::~RoboTVServer() {
     Cancel(10);
 
+    ClientMultiplexer::instance().stop();
+
     for(ClientList::iterator i = m_clients.begin(); i != m_clients.end(); i++) {
         delete(*i);
     }
 
+    LiveSessions::instance().clear();
+    LiveStandby::instance().clear();
+    DemuxerPool::instance().stop();
+
     isyslog("roboTV Server stopped");
 }
 
@@ -210,13 +220,17 @@ void RoboTVServer::clientConnected(int fd) {
     }
 
     RoboTvClient* connection = new RoboTvClient(fd, m_idCnt);
-    m_clients.push_back(connection);
+
+    {
+        std::lock_guard<std::mutex> lock(m_clientsLock);
+        m_clients.push_back(connection);
+    }
+
+    ClientMultiplexer::instance().add(connection);
     m_idCnt++;
 }
 
 void RoboTVServer::Action(void) {
-    fd_set fds;
-    struct timeval tv;
     cTimeMs recordingReloadTimer;
 
     bool recordingReloadTrigger = false;
@@ -242,29 +256,31 @@ void RoboTVServer::Action(void) {
     // listen for connections
     listen(m_serverFd, 10);
 
+    if(fcntl(m_serverFd, F_SETFL, fcntl(m_serverFd, F_GETFL) | O_NONBLOCK) == -1) {
+        esyslog("Error setting server socket to nonblocking mode");
+    }
+
+    // connections are accepted and served by the network threads
+    ClientMultiplexer::instance().start(m_serverFd, [this](int fd) {
+        clientConnected(fd);
+    });
+
     isyslog("roboTV Server started");
 
     while(Running()) {
-        FD_ZERO(&fds);
-        FD_SET(m_serverFd, &fds);
-
-        tv.tv_sec = 0;
-        tv.tv_usec = 250 * 1000;
+        cCondWait::SleepMs(250);
 
-        int r = select(m_serverFd + 1, &fds, NULL, NULL, &tv);
+        // remove disconnected clients (deleted outside the lock)
+        ClientList closed;
+        bool connected = false;
 
-        if(r == -1) {
-            esyslog("failed during select");
-            continue;
-        }
+        {
+            std::lock_guard<std::mutex> lock(m_clientsLock);
 
-        if(r == 0) {
-            // remove disconnected clients
             for(ClientList::iterator i = m_clients.begin(); i != m_clients.end();) {
 
-                if(!(*i)->Active()) {
-                    isyslog("Client with ID %u seems to be disconnected, removing from client list", (*i)->getId());
-                    delete(*i);
+                if((*i)->closed()) {
+                    closed.push_back(*i);
                     i = m_clients.erase(i);
                 }
                 else {
@@ -272,59 +288,62 @@ void RoboTVServer::Action(void) {
                 }
             }
 
-            // cleanup (every hour)
-            if(cleanupTimer.Elapsed() >= 60 * 60 * 1000) {
-                isyslog("removing outdated artwork");
-                artwork.triggerCleanup();
-                m_epgHandler.triggerCleanup();
-                // start gc
-                isyslog("Starting garbage collection in recordings cache");
-                cache.triggerCleanup();
-
-                cleanupTimer.Set(0);
-            }
+            connected = !m_clients.empty();
+        }
 
-            // reset inactivity timeout as long as there are clients connected
-            if(m_clients.size() > 0) {
-                ShutdownHandler.SetUserInactiveTimeout();
-            }
+        for(auto c : closed) {
+            isyslog("Client with ID %u seems to be disconnected, removing from client list", c->getId());
+            delete c;
+        }
 
-            // check for recording changes
-            Recordings.StateChanged(recState);
+        // remove expired timeshift sessions
+        LiveSessions::instance().cleanup();
 
-            if(recState != recStateOld) {
-                recordingReloadTrigger = true;
-                recordingReloadTimer.Set(1000);
-                isyslog("Recordings state changed (%i)", recState);
-                recStateOld = recState;
-            }
+        // update standby receivers
+        LiveStandby::instance().process();
 
-            // update recordings
-            if((recordingReloadTrigger && recordingReloadTimer.TimedOut())) {
+        // cleanup (every hour)
+        if(cleanupTimer.Elapsed() >= 60 * 60 * 1000) {
+            isyslog("removing outdated artwork");
+            artwork.triggerCleanup();
+            m_epgHandler.triggerCleanup();
+            // start gc
+            isyslog("Starting garbage collection in recordings cache");
+            cache.triggerCleanup();
 
-                // request clients to reload recordings
-                if(!m_clients.empty()) {
-                    isyslog("Requesting clients to reload recordings list");
+            cleanupTimer.Set(0);
+        }
 
-                    for(ClientList::iterator i = m_clients.begin(); i != m_clients.end(); i++) {
-                        (*i)->sendMoviesChange();
-                    }
-                }
+        // reset inactivity timeout as long as there are clients connected
+        if(connected) {
+            ShutdownHandler.SetUserInactiveTimeout();
+        }
 
-                recordingReloadTrigger = false;
-            }
+        // check for recording changes
+        Recordings.StateChanged(recState);
 
-            // no connect request -> continue waiting
-            continue;
+        if(recState != recStateOld) {
+            recordingReloadTrigger = true;
+            recordingReloadTimer.Set(1000);
+            isyslog("Recordings state changed (%i)", recState);
+            recStateOld = recState;
         }
 
-        int fd = accept(m_serverFd, 0, 0);
+        // update recordings
+        if((recordingReloadTrigger && recordingReloadTimer.TimedOut())) {
 
-        if(fd >= 0) {
-            clientConnected(fd);
-        }
-        else {
-            esyslog("accept failed");
+            // request clients to reload recordings
+            std::lock_guard<std::mutex> lock(m_clientsLock);
+
+            if(!m_clients.empty()) {
+                isyslog("Requesting clients to reload recordings list");
+
+                for(ClientList::iterator i = m_clients.begin(); i != m_clients.end(); i++) {
+                    (*i)->sendMoviesChange();
+                }
+            }
+
+            recordingReloadTrigger = false;
         }
     }
 
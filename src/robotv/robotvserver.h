@@ -26,6 +26,7 @@
 #define ROBOTV_SERVER_H
 
 #include <list>
+#include <mutex>
 #include <vdr/thread.h>
 #include <epg/epghandler.h>
 
@@ -52,6 +53,8 @@ protected:
 
     ClientList m_clients;
 
+    std::mutex m_clientsLock;
+
     RoboTVServerConfig& m_config;
 
     EpgHandler m_epgHandler;